@@ -271,6 +271,15 @@ class DAFoamSolver(ImplicitComponent):
         self.psi.setFromOptions()
         self.psi.zeroEntries()
 
+        # the cached dFdW and psi for all functions, computed by the multi-RHS adjoint
+        # this is used only if adjEqnOption-useMultiRHS is True
+        self.multiRHSCache = None
+
+        # the cached psi for each function, they are used as the initial guess for the same
+        # function's adjoint in the next optimization iteration
+        # this is used only if adjEqnOption-useAdjVecCache is True
+        self.adjVecCache = {}
+
         # if true, we need to compute the coloring
         if DASolver.getOption("adjEqnSolMethod") == "fixedPoint":
             self.runColoring = False
@@ -365,6 +374,9 @@ class DAFoamSolver(ImplicitComponent):
 
         self.DASolver.setStates(outputs[self.stateName])
 
+        # the states have changed so the multi-RHS adjoint cache is no longer valid
+        self.multiRHSCache = None
+
     def apply_linear(self, inputs, outputs, d_inputs, d_outputs, d_residuals, mode):
         # compute the matrix vector products for states and volume mesh coordinates
         # i.e., dRdWT*psi, dRdXvT*psi
@@ -459,7 +471,7 @@ class DAFoamSolver(ImplicitComponent):
                 if DASolver.getOption("writeMinorIterations"):
                     if DASolver.dRdWTPC is None or DASolver.ksp is None:
                         DASolver.dRdWTPC = PETSc.Mat().create(self.comm)
-                        DASolver.solver.calcdRdWT(1, DASolver.dRdWTPC)
+                        DASolver.solverPC.calcdRdWT(1, DASolver.dRdWTPC)
                         DASolver.ksp = PETSc.KSP().create(self.comm)
                         DASolver.solverAD.createMLRKSPMatrixFree(DASolver.dRdWTPC, DASolver.ksp)
                 # otherwise, we need to recompute the PC mat based on adjPCLag
@@ -506,7 +518,7 @@ class DAFoamSolver(ImplicitComponent):
                             if DASolver.dRdWTPC is not None:
                                 DASolver.dRdWTPC.destroy()
                             DASolver.dRdWTPC = PETSc.Mat().create(self.comm)
-                            DASolver.solver.calcdRdWT(1, DASolver.dRdWTPC)
+                            DASolver.solverPC.calcdRdWT(1, DASolver.dRdWTPC)
                             # reset the KSP
                             if DASolver.ksp is not None:
                                 DASolver.ksp.destroy()
@@ -528,8 +540,27 @@ class DAFoamSolver(ImplicitComponent):
                     # update the KSP tolerances the coupled adjoint before solving
                     self._updateKSPTolerances(self.psi, dFdW, DASolver.ksp)
 
+                # warm start the adjoint using the cached psi of the functions
+                useAdjVecCache = self.DASolver.getOption("adjEqnOption")["useAdjVecCache"]
+                if useAdjVecCache:
+                    psiGuess = self._getAdjVecInitGuess()
+                    if psiGuess is not None:
+                        DASolver.arrayVal2Vec(psiGuess, self.psi)
+                        DASolver.ksp.setInitialGuessNonzero(True)
+
+                # set the target gradient error for the inexact adjoint, -1 means exact adjoint
+                DASolver.solverAD.setInexactAdjointTol(DASolver.calcInexactAdjointTol())
+
                 # actually solving the adjoint linear equation using Petsc
-                fail = DASolver.solverAD.solveLinearEqn(DASolver.ksp, dFdW, self.psi)
+                if self.DASolver.getOption("adjEqnOption")["useMultiRHS"]:
+                    fail = self._solveLinearMultiRHS(dFdWArray, dFdW)
+                else:
+                    fail = DASolver.solverAD.solveLinearEqn(DASolver.ksp, dFdW, self.psi)
+
+                if useAdjVecCache:
+                    DASolver.ksp.setInitialGuessNonzero(self.DASolver.getOption("adjEqnOption")["useNonZeroInitGuess"])
+                    if not fail:
+                        self._updateAdjVecCache()
 
             elif adjEqnSolMethod == "fixedPoint":
                 solutionTime, renamed = DASolver.renameSolution(self.solution_counter)
@@ -541,6 +572,8 @@ class DAFoamSolver(ImplicitComponent):
                         print("Driver total derivatives for iteration: %d" % self.solution_counter, flush=True)
                         print("---------------------------------------------", flush=True)
                     self.solution_counter += 1
+                # set the target gradient error for the inexact adjoint, -1 means exact adjoint
+                DASolver.solverAD.setInexactAdjointTol(DASolver.calcInexactAdjointTol())
                 # solve the adjoint equation using the fixed-point adjoint approach
                 fail = DASolver.solverAD.runFPAdj(dFdW, self.psi)
             else:
@@ -558,6 +591,96 @@ class DAFoamSolver(ImplicitComponent):
             if fail:
                 raise AnalysisError("Adjoint solution failed!")
 
+    def _getAdjVecInitGuess(self):
+        # The adjoint equation is linear, so if the right-hand side is sum_i seed_i * dFdW_i, the
+        # initial guess is sum_i seed_i * psi_i, where psi_i is the cached psi for the ith function
+        # from the previous optimization iteration. Return None if any of the functions is not cached
+
+        functionSeeds = self.DASolver.functionSeeds
+        if len(functionSeeds) == 0:
+            return None
+
+        psiGuess = np.zeros(self.localAdjSize)
+        for functionName, seed in functionSeeds.items():
+            if functionName not in self.adjVecCache:
+                return None
+            psiGuess += seed * self.adjVecCache[functionName]
+
+        return psiGuess
+
+    def _updateAdjVecCache(self):
+        # save the psi for the function. We can do this only if the right-hand side
+        # has only one function, i.e., psi = seed * psi_function
+
+        functionSeeds = self.DASolver.functionSeeds
+        if len(functionSeeds) != 1:
+            return
+
+        functionName, seed = list(functionSeeds.items())[0]
+        # a zero seed gives a zero psi that carries no information about psi_function
+        if seed == 0.0:
+            return
+        self.adjVecCache[functionName] = self.DASolver.vec2Array(self.psi) / seed
+
+    def _solveLinearMultiRHS(self, dFdWArray, dFdW):
+        # Solve the adjoint equations for all functions together, such that the matrix-free
+        # dRdWT tape is recorded only once and shared by all the right-hand-side vectors.
+        # The adjoint equation is linear, so if dFdWArray = sum_i seed_i * dFdW_i, we can
+        # get psi = sum_i seed_i * psi_i without solving the adjoint equation again.
+        # If dFdWArray is not a linear combination of the functions' dFdW (e.g., it has
+        # contributions from other disciplines), we fall back to the regular adjoint solution
+
+        DASolver = self.DASolver
+
+        if self.multiRHSCache is None:
+            jacInput = DASolver.getStates()
+            funcNames = list(DASolver.getOption("function").keys())
+            dFdWArrays = []
+            rhsVecs = []
+            psiVecs = []
+            for functionName in funcNames:
+                product = np.zeros(self.localAdjSize)
+                DASolver.solverAD.calcJacTVecProduct(
+                    self.stateName,
+                    "stateVar",
+                    jacInput,
+                    functionName,
+                    "function",
+                    np.ones(1),
+                    product,
+                )
+                dFdWArrays.append(product)
+                rhsVecs.append(DASolver.array2Vec(product))
+                psiVecs.append(DASolver.array2Vec(np.zeros(self.localAdjSize)))
+
+            fail = DASolver.solverAD.solveLinearEqnMultiRHS(DASolver.ksp, rhsVecs, psiVecs)
+            if fail:
+                return fail
+
+            self.multiRHSCache = {}
+            for idxI, functionName in enumerate(funcNames):
+                self.multiRHSCache[functionName] = [dFdWArrays[idxI], DASolver.vec2Array(psiVecs[idxI])]
+                rhsVecs[idxI].destroy()
+                psiVecs[idxI].destroy()
+
+        # check whether the RHS is a linear combination of the cached dFdW
+        rhsArray = np.zeros(self.localAdjSize)
+        psiArray = np.zeros(self.localAdjSize)
+        for functionName, seed in DASolver.functionSeeds.items():
+            if functionName in self.multiRHSCache:
+                rhsArray += seed * self.multiRHSCache[functionName][0]
+                psiArray += seed * self.multiRHSCache[functionName][1]
+        diffNorm = np.sqrt(self.comm.allreduce(np.sum((rhsArray - dFdWArray) ** 2), op=MPI.SUM))
+        rhsNorm = np.sqrt(self.comm.allreduce(np.sum(dFdWArray**2), op=MPI.SUM))
+
+        if rhsNorm > 0 and diffNorm <= 1e-10 * rhsNorm:
+            if self.comm.rank == 0:
+                print("Reusing the multi-RHS adjoint solution for %s" % list(DASolver.functionSeeds.keys()), flush=True)
+            DASolver.arrayVal2Vec(psiArray, self.psi)
+            return 0
+        else:
+            return DASolver.solverAD.solveLinearEqn(DASolver.ksp, dFdW, self.psi)
+
     def _updateKSPTolerances(self, psi, dFdW, ksp):
         # Here we need to manually update the KSP tolerances because the default
         # relative tolerance will always want to converge the adjoint to a fixed
@@ -747,6 +870,7 @@ class DAFoamFunctions(ExplicitComponent):
 
         # loop over all d_inputs keys and compute the partials accordingly
         inputDict = DASolver.getOption("inputInfo")
+        DASolver.functionSeeds = {}
         for functionName in list(d_outputs.keys()):
 
             seed = d_outputs[functionName]
@@ -755,6 +879,9 @@ class DAFoamFunctions(ExplicitComponent):
             if abs(seed) < 1e-12:
                 continue
 
+            # record the seed such that the solver comp can reuse the multi-RHS adjoint solution
+            DASolver.functionSeeds[functionName] = float(seed[0])
+
             for inputName in list(d_inputs.keys()):
                 # compute dFdW * seed
                 if inputName == self.stateName:
@@ -1319,12 +1446,43 @@ class DAFoamSolverUnsteady(ExplicitComponent):
     def add_dvgeo(self, DVGeo):
         self.DVGeo = DVGeo
 
+    def _storePCMat(self, PCMat):
+        """
+        Return the pre-computed PC mat to save in the self.dRdWTPC dict. If pcPrecision is single,
+        we save the local CSR arrays of PCMat with single precision values and destroy PCMat.
+        """
+        DASolver = self.DASolver
+        if DASolver.getOption("adjEqnOption")["pcPrecision"] == "single":
+            rowPtr, cols, vals = PCMat.getValuesCSR()
+            storedMat = {"sizes": PCMat.getSizes(), "csr": (rowPtr, cols, vals.astype(np.float32))}
+            PCMat.destroy()
+            return storedMat
+        else:
+            return PCMat
+
+    def _getPCMat(self, storedMat):
+        """
+        Return the PC mat from the self.dRdWTPC dict. If it is saved in single precision, we create
+        a new double precision PC mat from the CSR arrays
+        """
+        if isinstance(storedMat, dict):
+            rowPtr, cols, vals = storedMat["csr"]
+            PCMat = PETSc.Mat().createAIJ(
+                size=storedMat["sizes"], csr=(rowPtr, cols, vals.astype(PETSc.ScalarType)), comm=PETSc.COMM_WORLD
+            )
+            return PCMat
+        else:
+            return storedMat
+
     def compute(self, inputs, outputs):
 
         with cd(self.run_directory):
 
             DASolver = self.DASolver
 
+            # remove the checkpoints from the previous primal run such that we read the states from the disk
+            DASolver.clearCheckpoints()
+
             # if readZeroFields, we need to read in the states from the 0 folder every time
             # we start the primal here we read in all time levels. If readZeroFields is not set,
             # we will use the latest flow fields (from a previous primal call) as the init conditions
@@ -1347,6 +1505,8 @@ class DAFoamSolverUnsteady(ExplicitComponent):
             # solve the flow with the current design variable
             # if the mesh is not OK, do not run the primal
             if meshOK:
+                # save the initial states if checkpointing is used for the unsteady adjoint
+                DASolver.initCheckpoints()
                 # solve the primal
                 DASolver()
             else:
@@ -1359,6 +1519,10 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                 raise AnalysisError("Primal solution failed!")
                 return
 
+            # collect the snapshots saved during the primal and save the end time states,
+            # they will be used as the starting point of the backward sweep
+            DASolver.finalizeCheckpoints()
+
             # get the objective functions
             funcs = {}
             DASolver.evalFunctions(funcs)
@@ -1442,14 +1606,18 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                 print("Pre-Computing preconditiner mat for t = %f" % endTime, flush=True)
 
             dRdWTPC1 = PETSc.Mat().create(PETSc.COMM_WORLD)
-            DASolver.solver.calcdRdWT(1, dRdWTPC1)
+            DASolver.solverPC.calcdRdWT(1, dRdWTPC1)
             # always update the PC mat values using OpenFOAM's fvMatrix
             # DASolver.solver.calcPCMatWithFvMatrix(dRdWTPC1)
-            self.dRdWTPC[str(endTime)] = dRdWTPC1
+            self.dRdWTPC[str(endTime)] = self._storePCMat(dRdWTPC1)
 
             # if we define some extra PCMat in PCMatPrecomputeInterval, calculate them here
-            # and set them to the self.dRdWTPC dict
+            # and set them to the self.dRdWTPC dict. NOTE: for binomial checkpointing, reading the
+            # states here would remove all the snapshots after the earliest precompute time, so the
+            # extra PCMats are computed in the backward sweep below when the states are restored
             for timeIndex in range(endTimeIndex - 1, 0, -1):
+                if DASolver.checkpoints is not None:
+                    break
                 if timeIndex % PCMatPrecomputeInterval == 0:
                     t = timeIndex * deltaT
                     if self.comm.rank == 0:
@@ -1464,78 +1632,124 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                         DASolver.readDynamicMeshPoints(t, deltaT, timeIndex, ddtSchemeOrder)
                     # calc the preconditioner mat
                     dRdWTPC1 = PETSc.Mat().create(PETSc.COMM_WORLD)
-                    DASolver.solver.calcdRdWT(1, dRdWTPC1)
+                    DASolver.solverPC.calcdRdWT(1, dRdWTPC1)
                     # always update the PC mat values using OpenFOAM's fvMatrix
                     # DASolver.solver.calcPCMatWithFvMatrix(dRdWTPC1)
-                    self.dRdWTPC[str(t)] = dRdWTPC1
+                    self.dRdWTPC[str(t)] = self._storePCMat(dRdWTPC1)
 
         if self.adjEqnSolMethod == "Krylov":
             # Initialize the KSP object using the PCMat from the endTime
-            PCMat = self.dRdWTPC[str(endTime)]
+            PCMat = self._getPCMat(self.dRdWTPC[str(endTime)])
             ksp = PETSc.KSP().create(PETSc.COMM_WORLD)
             DASolver.solverAD.createMLRKSPMatrixFree(PCMat, ksp)
 
         inputDict = DASolver.getOption("inputInfo")
 
-        # init the dFdW vec
-        dFdW = PETSc.Vec().create(PETSc.COMM_WORLD)
-        dFdW.setSizes((localAdjSize, PETSc.DECIDE), bsize=1)
-        dFdW.setFromOptions()
-        dFdW.zeroEntries()
-
-        # init the adjoint vector
-        psi = dFdW.duplicate()
-        psi.zeroEntries()
+        # we solve the adjoint for all the outputs in one backward time sweep, so the states at
+        # each time step are read only once and the tape and PC mat are shared by all outputs.
+        # Here we only consider the outputs with nonzero seeds
+        activeOutputs = []
+        for outputName in list(self.unsteadyCompOutput.keys()):
+            if np.linalg.norm(d_outputs[outputName]) >= 1e-12:
+                activeOutputs.append(outputName)
+
+        # the vecs and arrays for each output
+        dFdW = {}
+        psi = {}
+        dRdW0TPsi = {}
+        dRdW00TPsi = {}
+        dRdW00TPsiBuffer = {}
+        totals = {}
+        for outputName in activeOutputs:
+            # init the dFdW vec
+            dFdW[outputName] = PETSc.Vec().create(PETSc.COMM_WORLD)
+            dFdW[outputName].setSizes((localAdjSize, PETSc.DECIDE), bsize=1)
+            dFdW[outputName].setFromOptions()
+            dFdW[outputName].zeroEntries()
+            # init the adjoint vector
+            psi[outputName] = dFdW[outputName].duplicate()
+            psi[outputName].zeroEntries()
+            # initialize the adjoint vecs
+            dRdW0TPsi[outputName] = np.zeros(localAdjSize)
+            dRdW00TPsi[outputName] = np.zeros(localAdjSize)
+            dRdW00TPsiBuffer[outputName] = np.zeros(localAdjSize)
+            # we need to zero the total derivative for each output
+            totals[outputName] = {}
+            for inputName in list(inputs.keys()):
+                totals[outputName][inputName] = np.zeros_like(inputs[inputName])
 
-        # initialize the adjoint vecs
-        dRdW0TPsi = np.zeros(localAdjSize)
-        dRdW00TPsi = np.zeros(localAdjSize)
-        dRdW00TPsiBuffer = np.zeros(localAdjSize)
         dFdWArray = np.zeros(localAdjSize)
         psiArray = np.zeros(localAdjSize)
         tempdFdWArray = np.zeros(localAdjSize)
 
-        # loop over all function, calculate dFdW, and solve the adjoint
-        # for functionName in list(d_outputs.keys()):
-        for outputName in list(self.unsteadyCompOutput.keys()):
+        # whether to record the residuals and functions only once per time step using the tape session.
+        # The tape session is only used for the Krylov adjoint because the fixed-point adjoint records its
+        # own tape
+        useTapeSession = self.adjEqnSolMethod == "Krylov" and DASolver.getOption("unsteadyAdjoint")["tapeSession"]
 
-            # we need to zero the total derivative for each function
-            totals = {}
-            for inputName in list(inputs.keys()):
-                totals[inputName] = np.zeros_like(inputs[inputName])
+        # loop over all time steps and solve the adjoint for all outputs and accumulate the totals
+        adjointFail = 0
+        for n in range(endTimeIndex, 0, -1):
 
-            seed = d_outputs[outputName]
+            # if all the seeds are zero, we don't need to solve the adjoint
+            if len(activeOutputs) == 0:
+                break
 
-            # if the seed is zero, do not compute the adjoint and pass to
-            # the next funnction
-            if np.linalg.norm(seed) < 1e-12:
-                continue
+            timeVal = n * deltaT
 
-            # zero the vecs
-            dRdW0TPsi[:] = 0.0
-            dRdW00TPsi[:] = 0.0
-            dRdW00TPsiBuffer[:] = 0.0
-            dFdW.zeroEntries()
+            if self.comm.rank == 0:
+                print("---- Solving unsteady adjoint for %s. t = %f ----" % (activeOutputs, timeVal), flush=True)
 
-            # loop over all time steps and solve the adjoint and accumulate the totals
-            adjointFail = 0
-            for n in range(endTimeIndex, 0, -1):
-                timeVal = n * deltaT
+            # set the time value and index in the OpenFOAM layer. Note: this is critical
+            # because if timeIndex < 2, OpenFOAM will not use the oldTime.oldTime for 2nd
+            # ddtScheme and mess up the totals. Check backwardDdtScheme.C
+            DASolver.solver.setTime(timeVal, n)
+            DASolver.solverAD.setTime(timeVal, n)
+            # now we can read the variables
+            # read the state, state.oldTime, etc and update self.wVec for this time instance
+            DASolver.readStateVars(timeVal, deltaT)
+            # if it is dynamic mesh, read the mesh points
+            if DASolver.getOption("dynamicMesh")["active"]:
+                DASolver.readDynamicMeshPoints(timeVal, deltaT, n, ddtSchemeOrder)
 
-                if self.comm.rank == 0:
-                    print("---- Solving unsteady adjoint for %s. t = %f ----" % (outputName, timeVal), flush=True)
-
-                # set the time value and index in the OpenFOAM layer. Note: this is critical
-                # because if timeIndex < 2, OpenFOAM will not use the oldTime.oldTime for 2nd
-                # ddtScheme and mess up the totals. Check backwardDdtScheme.C
-                DASolver.solver.setTime(timeVal, n)
-                DASolver.solverAD.setTime(timeVal, n)
-                # now we can read the variables
-                # read the state, state.oldTime, etc and update self.wVec for this time instance
-                DASolver.readStateVars(timeVal, deltaT)
-                # if it is dynamic mesh, read the mesh points
-                if DASolver.getOption("dynamicMesh")["active"]:
-                    DASolver.readDynamicMeshPoints(timeVal, deltaT, n, ddtSchemeOrder)
+            # check if we need to update the PC Mat vals or use the pre-computed PC matrix
+            if self.adjEqnSolMethod == "Krylov":
+                # compute the extra PCMat that is not pre-computed for binomial checkpointing
+                if n % PCMatPrecomputeInterval == 0 and str(timeVal) not in list(self.dRdWTPC.keys()):
+                    if self.comm.rank == 0:
+                        print("Computing preconditiner mat for t = %f" % timeVal, flush=True)
+                    dRdWTPC1 = PETSc.Mat().create(PETSc.COMM_WORLD)
+                    DASolver.solverPC.calcdRdWT(1, dRdWTPC1)
+                    self.dRdWTPC[str(timeVal)] = self._storePCMat(dRdWTPC1)
+                if str(timeVal) in list(self.dRdWTPC.keys()):
+                    if self.comm.rank == 0:
+                        print("Using pre-computed KSP PC mat for %f" % timeVal, flush=True)
+                    # NOTE: if the PC mats are saved in single precision, the previous PCMat is a
+                    # temporary mat, the KSP holds a reference to it so it is freed once replaced
+                    if isinstance(self.dRdWTPC[str(timeVal)], dict) and PCMat is not None:
+                        PCMat.destroy()
+                    PCMat = self._getPCMat(self.dRdWTPC[str(timeVal)])
+                    DASolver.solverAD.updateKSPPCMat(PCMat, ksp)
+                if n % PCMatUpdateInterval == 0 and n < endTimeIndex:
+                    # udpate part of the PC mat
+                    if self.comm.rank == 0:
+                        print("Updating dRdWTPC mat value using OF fvMatrix", flush=True)
+                    DASolver.solver.calcPCMatWithFvMatrix(PCMat)
+
+            if useTapeSession:
+                # record the residuals and functions only once for this time step. The tape will be
+                # used for dFdW, dFdX, the adjoint solution, dRdXTPsi, and dRdWOldTPsi below
+                DASolver.solverAD.tapeSessionBegin()
+                for inputName in list(inputs.keys()):
+                    DASolver.solverAD.tapeSessionAddInput(inputName, inputDict[inputName]["type"], inputs[inputName])
+                DASolver.solverAD.tapeSessionRecord()
+            else:
+                jacInput = DASolver.getStates()
+
+            dFScaling = {}
+            dFdX = {}
+            for outputName in activeOutputs:
+                seed = d_outputs[outputName]
 
                 # calculate dFd? scaling, if time index is within the unsteady objective function
                 # index range, prescribed in unsteadyAdjointDict, we calculate dFdW
@@ -1544,61 +1758,87 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                 # NOTE: we just use the first function in the output for dFScaling and
                 # assume all the functions to have the same timeOp for this output
                 firstFunctionName = self.unsteadyCompOutput[outputName][0]
-                dFScaling = DASolver.solver.getdFScaling(firstFunctionName, n - 1)
+                dFScaling[outputName] = DASolver.solver.getdFScaling(firstFunctionName, n - 1)
 
                 # loop over all function for this output, compute their dFdW, and add them up to
                 # get the dFdW for this output
                 dFdWArray[:] = 0.0
-                for functionName in self.unsteadyCompOutput[outputName]:
+                if useTapeSession:
+                    # seed all functions of this output together, and get dFdW and dFdX in one tape evaluation
+                    for functionName in self.unsteadyCompOutput[outputName]:
+                        DASolver.solverAD.tapeSessionSetFunctionSeed(
+                            functionName, float(seed[0]) * dFScaling[outputName]
+                        )
+                    DASolver.solverAD.tapeSessionEvaluate()
+                    DASolver.solverAD.tapeSessionGetStateGradient(0, dFdWArray)
+                    dFdX[outputName] = {}
+                    for inputName in list(inputs.keys()):
+                        dFdX[outputName][inputName] = np.zeros_like(inputs[inputName])
+                        DASolver.solverAD.tapeSessionGetInputGradient(inputName, dFdX[outputName][inputName])
+                    DASolver.solverAD.tapeSessionClearAdjoints()
+                else:
+                    for functionName in self.unsteadyCompOutput[outputName]:
 
-                    # calculate dFdW
-                    jacInput = DASolver.getStates()
-                    DASolver.solverAD.calcJacTVecProduct(
-                        "states",
-                        "stateVar",
-                        jacInput,
-                        functionName,
-                        "function",
-                        seed,
-                        tempdFdWArray,  # NOTE: we just use tempdFdWArray to hold a temp dFdW for this function
-                    )
+                        # calculate dFdW
+                        DASolver.solverAD.calcJacTVecProduct(
+                            "states",
+                            "stateVar",
+                            jacInput,
+                            functionName,
+                            "function",
+                            seed,
+                            tempdFdWArray,  # NOTE: we just use tempdFdWArray to hold a temp dFdW for this function
+                        )
 
-                    dFdWArray += tempdFdWArray * dFScaling
+                        dFdWArray += tempdFdWArray * dFScaling[outputName]
 
                 # do dFdW - dRdW0TPsi - dRdW00TPsi
                 if ddtSchemeOrder == 1:
-                    dFdWArray = dFdWArray - dRdW0TPsi
+                    dFdWArray = dFdWArray - dRdW0TPsi[outputName]
                 elif ddtSchemeOrder == 2:
-                    dFdWArray = dFdWArray - dRdW0TPsi - dRdW00TPsi
+                    dFdWArray = dFdWArray - dRdW0TPsi[outputName] - dRdW00TPsi[outputName]
                     # now copy the buffer vec dRdW00TPsiBuffer to dRdW00TPsi for the next time step
-                    dRdW00TPsi[:] = dRdW00TPsiBuffer
+                    dRdW00TPsi[outputName][:] = dRdW00TPsiBuffer[outputName]
                 else:
                     print("ddtSchemeOrder not valid!" % ddtSchemeOrder)
 
-                # check if we need to update the PC Mat vals or use the pre-computed PC matrix
-                if self.adjEqnSolMethod == "Krylov":
-                    if str(timeVal) in list(self.dRdWTPC.keys()):
-                        if self.comm.rank == 0:
-                            print("Using pre-computed KSP PC mat for %f" % timeVal, flush=True)
-                        PCMat = self.dRdWTPC[str(timeVal)]
-                        DASolver.solverAD.updateKSPPCMat(PCMat, ksp)
-                    if n % PCMatUpdateInterval == 0 and n < endTimeIndex:
-                        # udpate part of the PC mat
-                        if self.comm.rank == 0:
-                            print("Updating dRdWTPC mat value using OF fvMatrix", flush=True)
-                        DASolver.solver.calcPCMatWithFvMatrix(PCMat)
+                DASolver.arrayVal2Vec(dFdWArray, dFdW[outputName])
 
-                # now solve the adjoint eqn
-                DASolver.arrayVal2Vec(dFdWArray, dFdW)
+            # now solve the adjoint eqns for all outputs. For Krylov, all the outputs share the
+            # same dRdWT tape and ksp at this time step
+            if self.adjEqnSolMethod == "Krylov":
+                adjointFail = DASolver.solverAD.solveLinearEqnMultiRHS(
+                    ksp,
+                    [dFdW[outputName] for outputName in activeOutputs],
+                    [psi[outputName] for outputName in activeOutputs],
+                )
+            elif self.adjEqnSolMethod == "fixedPoint":
+                for outputName in activeOutputs:
+                    adjointFail += DASolver.solverAD.solveAdjointFP(dFdW[outputName], psi[outputName])
+
+            # if one adjoint solution fails, return immediate without solving for the rest of steps.
+            if adjointFail > 0:
+                if useTapeSession:
+                    DASolver.solverAD.tapeSessionFinish()
+                break
 
-                if self.adjEqnSolMethod == "Krylov":
-                    adjointFail = DASolver.solverAD.solveLinearEqn(ksp, dFdW, psi)
-                elif self.adjEqnSolMethod == "fixedPoint":
-                    adjointFail = DASolver.solverAD.solveAdjointFP(dFdW, psi)
-
-                # if one adjoint solution fails, return immediate without solving for the rest of steps.
-                if adjointFail > 0:
-                    break
+            for outputName in activeOutputs:
+                seed = d_outputs[outputName]
+                DASolver.vecVal2Array(psi[outputName], psiArray)
+
+                if useTapeSession:
+                    # get dRdXTPsi for all inputs and dRdWOldTPsi in one tape evaluation
+                    DASolver.solverAD.tapeSessionSetResidualSeed(psiArray)
+                    DASolver.solverAD.tapeSessionEvaluate()
+                    for inputName in list(inputs.keys()):
+                        dRdXTPsi = np.zeros_like(inputs[inputName])
+                        DASolver.solverAD.tapeSessionGetInputGradient(inputName, dRdXTPsi)
+                        totals[outputName][inputName] += dFdX[outputName][inputName] - dRdXTPsi
+                    DASolver.solverAD.tapeSessionGetStateGradient(1, dRdW0TPsi[outputName])
+                    if ddtSchemeOrder == 2:
+                        DASolver.solverAD.tapeSessionGetStateGradient(2, dRdW00TPsiBuffer[outputName])
+                    DASolver.solverAD.tapeSessionClearAdjoints()
+                    continue
 
                 # loop over all inputs and compute total derivs
                 for inputName in list(inputs.keys()):
@@ -1606,7 +1846,7 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                     # calculate dFdX
                     inputType = inputDict[inputName]["type"]
                     jacInput = inputs[inputName]
-                    dFdX = np.zeros_like(jacInput)
+                    dFdXOutput = np.zeros_like(jacInput)
                     tempdFdX = np.zeros_like(jacInput)
 
                     # loop over all function for this output, compute their dFdX, and add them up to
@@ -1622,11 +1862,10 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                             tempdFdX,
                         )
                         # we need to scale the dFdX for unsteady adjoint too
-                        dFdX += tempdFdX * dFScaling
+                        dFdXOutput += tempdFdX * dFScaling[outputName]
 
                     # calculate dRdX^T * psi
                     dRdXTPsi = np.zeros_like(jacInput)
-                    DASolver.vecVal2Array(psi, psiArray)
                     DASolver.solverAD.calcJacTVecProduct(
                         inputName,
                         inputType,
@@ -1638,19 +1877,23 @@ class DAFoamSolverUnsteady(ExplicitComponent):
                     )
 
                     # total derivative
-                    totals[inputName] += dFdX - dRdXTPsi
+                    totals[outputName][inputName] += dFdXOutput - dRdXTPsi
 
                 # we need to calculate dRdW0TPsi for the previous time step
                 if ddtSchemeOrder == 1:
-                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi)
+                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi[outputName])
                 elif ddtSchemeOrder == 2:
                     # do the same for the previous previous step, but we need to save it to a buffer vec
                     # because dRdW00TPsi will be used 2 steps before
-                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi)
-                    DASolver.solverAD.calcdRdWOldTPsiAD(2, psiArray, dRdW00TPsiBuffer)
+                    DASolver.solverAD.calcdRdWOldTPsiAD(1, psiArray, dRdW0TPsi[outputName])
+                    DASolver.solverAD.calcdRdWOldTPsiAD(2, psiArray, dRdW00TPsiBuffer[outputName])
+
+            if useTapeSession:
+                DASolver.solverAD.tapeSessionFinish()
 
+        for outputName in activeOutputs:
             for inputName in list(inputs.keys()):
-                d_inputs[inputName] += totals[inputName]
+                d_inputs[inputName] += totals[outputName][inputName]
 
         # once the adjoint is done, we will assign OF fields with the endTime solution
         # so, if the next primal does not read fields from the 0 time, we will continue
@@ -18,6 +18,7 @@ import os
 import sys
 import copy
 import shutil
+from math import comb
 import numpy as np
 from mpi4py import MPI
 from collections import OrderedDict
@@ -355,6 +356,17 @@ class DAOPTION(object):
             "State": 1.0e-6,
         }
 
+        ## The method to compute the colored partial derivatives for the dRdWTPC matrix. Options are:
+        ## "FD": finite-difference with the step size defined in adjPartDerivFDStep;
+        ## "forwardAD": forward-mode AD, which gives exact partial derivatives. This is an accuracy-only
+        ## option, e.g., for the cases where the FD step size is hard to choose. It is NOT faster than FD:
+        ## it still seeds one color per residual evaluation, and each evaluation also computes the tangents.
+        ## This requires the ADF library to be compiled, and an additional ADF solver object will be
+        ## initialized to compute dRdWTPC in the reverse-mode adjoint. NOTE: the ADF solver holds another
+        ## full copy of the mesh, fields, and models on each rank, which increases the memory usage and
+        ## offsets the memory saved by useSingleSolverInstance
+        self.adjPartDerivMethod = "FD"
+
         ## Which options to use to improve the adjoint equation convergence of transonic conditions
         ## This is used only for transonic solvers such as DARhoSimpleCFoam
         self.transonicPCOption = -1
@@ -362,6 +374,24 @@ class DAOPTION(object):
         ## Options for unsteady adjoint. mode can be hybrid or timeAccurate
         ## Here nTimeInstances is the number of time instances and periodicity is the
         ## periodicity of flow oscillation (hybrid adjoint only)
+        ## checkpointMode: "None" writes the states to the disk for every time step and reads them
+        ## back in the backward sweep. "binomial" keeps at most nCheckpoints state snapshots and
+        ## recomputes the primal between the snapshots using a binomial (revolve-style) schedule. The
+        ## states at the initial and end times are always kept. The snapshots of the first binomial sweep
+        ## are placed during the primal run, so the backward sweep does not re-advance from the initial time.
+        ## If checkpointOnDisk is True, the snapshots are saved as binary files in the checkpoints folder
+        ## instead of in memory.
+        ## "memory" saves the states for all time steps in memory, with no recomputation. In this case,
+        ## stateCompression can be "None", "lossless" (zlib), or "quantize" (lossy, the error is bounded
+        ## by stateCompressionTol relative to the max magnitude of each state variable among all processors).
+        ## The compressed states are saved as the delta to the uncompressed key states saved every
+        ## stateKeyInterval steps. For binomial and memory, the states are not written to the disk during the
+        ## primal unless checkpointWriteStates is True, e.g., for post-processing or as a fallback to read the
+        ## states that are not found in memory. Otherwise, reading such states raises an error
+        ## tapeSession: if True, the residuals and functions are recorded in the AD tape only once for each
+        ## time step of the Krylov unsteady adjoint, and the tape is reused for dFdW, dFdX, dRdXTPsi,
+        ## dRdWOldTPsi, and the matrix-free adjoint solution. Otherwise, each of them records its own tape
+        ## NOTE: checkpointing does not support dynamic mesh cases yet
         self.unsteadyAdjoint = {
             "mode": "None",
             "PCMatPrecomputeInterval": 100,
@@ -369,6 +399,14 @@ class DAOPTION(object):
             "reduceIO": True,
             "additionalOutput": ["None"],
             "readZeroFields": True,
+            "checkpointMode": "None",
+            "nCheckpoints": 20,
+            "checkpointOnDisk": False,
+            "checkpointWriteStates": False,
+            "stateCompression": "None",
+            "stateCompressionTol": 1e-8,
+            "stateKeyInterval": 20,
+            "tapeSession": False,
         }
 
         ## The interval of recomputing the pre-conditioner matrix dRdWTPC for solveAdjoint
@@ -388,6 +426,17 @@ class DAOPTION(object):
         ## Progress in Aerospace Science, 2019.
         self.useAD = {"mode": "reverse", "dvName": "None", "seedIndex": -9999}
 
+        ## Whether to use only one solver instance (the ADR library) for both the primal and adjoint.
+        ## By default, we create a NoAD solver for the primal and an ADR solver for the adjoint, and
+        ## each of them holds a full copy of the mesh, fields, and models. If this is True, the ADR
+        ## solver runs the primal with the AD tape passive, and the NoAD solver is not created. This
+        ## avoids holding a second copy of the mesh and fields, but the primal becomes slower because
+        ## of the AD scalar type. Use tests/runBenchmark_SingleSolverInstance.py to measure the
+        ## primal slowdown and the memory saved for a given case. NOTE: this option is experimental,
+        ## the slowdown and the memory saving have not been measured yet.
+        ## This is only supported for useAD-mode = reverse
+        self.useSingleSolverInstance = False
+
         ## whether to use the constrainHbyA in the pEqn. The DASolvers are similar to OpenFOAM's native
         ## solvers except that we directly compute the HbyA term without any constraints. In other words,
         ## we comment out the constrainHbyA line in the pEqn. However, some cases may diverge without
@@ -416,6 +465,7 @@ class DAOPTION(object):
             #    "outputUpperBound": 1e1,
             #    "outputLowerBound": -1e1,
             #    "activationFunction": "sigmoid",  # other options are relu and tanh
+            #    "nnBlockSize": 0,  # number of cells evaluated together (e.g., 256), 0 (default) evaluates one cell at a time
             #    "printInputInfo": True,
             #    "defaultOutputValue": 1.0,
             # },
@@ -454,6 +504,18 @@ class DAOPTION(object):
         ## Whether running the optimization in the debug mode, which prints extra information.
         self.debug = False
 
+        ## Whether to profile the primal and adjoint computation. If active, we time the named regions:
+        ## solvePrimal, functionEvaluation, readStateVars, runColoring, pcColoring and pcFDSweep (the
+        ## connectivity/coloring and the partial derivative computation for dRdWTPC), kspSetup, kspSolve,
+        ## tapeRecord, and tapeEvaluate. For the reverse-mode AD, we also collect the statistics of the
+        ## largest AD tape, i.e., the number of statements and Jacobian entries, the tape memory, and the
+        ## adjoint vector size. The min, max, and avg among all processors are written to
+        ## outputDir/profile_XXX.json, one file for each primal solution and the derivative computation
+        ## that follows it. Each solver library (NoAD, ADR, and ADF) has its own section in the file.
+        ## The regions can be nested, e.g., kspSolve includes tapeRecord and tapeEvaluate. One can also
+        ## call DASolver.writeProfile() at any time, e.g., after the optimization is done
+        self.profiling = {"active": False, "outputDir": "profiling"}
+
         ## Whether to write Jacobian matrices to file for debugging
         ## Example:
         ##    writeJacobians = ["dRdWT", "dFdW"]
@@ -475,15 +537,77 @@ class DAOPTION(object):
         ## debugging the accuracy of partial computation, always set it to True
         self.adjUseColoring = True
 
+        ## The parallel distance-2 graph coloring algorithm. Options are:
+        ## "legacy": the original coloring based on Petsc matrices and global vector scatters.
+        ## "speculative": speculative coloring on integer CSR graphs. It only communicates with the
+        ## neighbouring processors so it scales to a large number of processors. NOTE: it gives a
+        ## different coloring (and number of colors) than the legacy one.
+        self.adjColoringEngine = "legacy"
+
+        ## Whether to cache the dRdW connectivity, coloring, and preallocation vectors to the disk
+        ## (dRdWJacConCache_*.bin, one file per processor). If the cache is valid, the subsequent
+        ## dRdWT and dRdWTPC computations, including those in later runs, will skip the connectivity
+        ## setup and only compute the Jacobian values. The cache is keyed on the mesh topology,
+        ## the number of processors, and the connectivity levels (e.g., maxResConLv4JacPCMat), and
+        ## it will be ignored and re-written if any of them changes.
+        self.useJacConCache = False
+
+        ## Whether to keep the dRdW connectivity, coloring, and preallocation vectors in memory
+        ## between the dRdWT and dRdWTPC computations. They are reused as long as the mesh topology
+        ## and the connectivity levels do not change (the same check as useJacConCache), so only the
+        ## Jacobian values are recomputed. This is useful for dynamic/deforming meshes and the
+        ## unsteady adjoint, where dRdWTPC is computed for many time instances with the same topology.
+        ## Use it together with usePCMatInsertMap to also reuse the sparsity pattern of dRdWTPC.
+        ## NOTE: the connectivity matrix has about the same number of nonzeros as dRdWTPC.
+        self.keepJacConInMemory = False
+
+        ## Whether to assemble dRdWTPC by directly writing the values into the local CSR arrays.
+        ## The first dRdWTPC is assembled with MatSetValues as usual and it is used as the template
+        ## sparsity pattern. The CSR slot of each (row, col) pair is then computed once and reused
+        ## by the subsequent dRdWTPC computations and by the unsteady PC updates that use the
+        ## fvMatrix coefficients. This only works for adjEqnOption["pcMatType"] = "aij" and it
+        ## needs about one additional integer per nonzero. NOTE: jacLowerBounds["dRdWPC"] is
+        ## ignored when this option is on because a value-dependent sparsity pattern can not be reused.
+        self.usePCMatInsertMap = False
+
         ## The Petsc options for solving the adjoint linear equation. These options should work for
         ## most of the case. If the adjoint does not converge, try to increase pcFillLevel to 2, or
-        ## try "jacMatReOrdering": "nd"
+        ## try "jacMatReOrdering": "nd". If useMultiRHS is True, the adjoint equations for all the
+        ## functions will be solved together in the first solve_linear call of each optimization
+        ## iteration. In this case, the matrix-free dRdWT AD tape is recorded only once and it is
+        ## shared by all the right-hand-side vectors. The subsequent solve_linear calls reuse the
+        ## computed psi if their right-hand-side vectors are linear combinations of the dFdW vectors
+        ## of the functions; otherwise, the adjoint equation is solved as usual. If pcPrecision is
+        ## "single", the ILU factors of the preconditioner are stored in single precision, while GMRES
+        ## still runs in double precision. This reduces the memory of the factors by about 33% per
+        ## nonzero (a float value and a label index take 8 bytes, instead of 12 bytes for a double).
+        ## The ASM overlap matrix extracted by Petsc is still stored in double precision.
+        ## For unsteady adjoint, the pre-computed PC matrices are also stored in single precision.
+        ## If pcMatType is "baij", the PC matrix is stored as a block matrix with one block per
+        ## cell and the ILU becomes a block ILU. This reduces the index memory and speeds up the PC.
+        ## It requires adjStateOrdering = "cell" and solvers without surfaceScalarStates (e.g., phi).
+        ## If pcType is "fieldsplit", we use a physics-based field-split PC with the splits for U, p,
+        ## phi, other scalars (e.g., T), and turbulence states. The p split uses algebraic multigrid
+        ## (GAMG) and the other splits use block Jacobi ILU(0). fieldSplitType can be "multiplicative",
+        ## "additive", "symmetricMultiplicative", or "schur" (p and the rest, with a selfp Schur
+        ## complement). This avoids the high ILU fill levels for large meshes.
+        ## If recycleSize > 0, we keep a recycled Krylov subspace with at most recycleSize vectors
+        ## between the adjoint solutions (GCRO-DR style). The subspace is deflated from the GMRES
+        ## iterations, and it is carried over to the next functions and optimization iterations.
+        ## Each adjoint solution needs recycleSize + 2 extra matrix-vector products. A value of 5
+        ## to 10 is usually enough. If useAdjVecCache is True, we save the adjoint vector for each
+        ## function and use it as the initial guess for the same function's adjoint solution in
+        ## the next optimization iteration.
         self.adjEqnOption = {
             "globalPCIters": 0,
             "asmOverlap": 1,
             "localPCIters": 1,
             "jacMatReOrdering": "rcm",
             "pcFillLevel": 1,
+            "pcPrecision": "double",
+            "pcMatType": "aij",
+            "pcType": "asm",
+            "fieldSplitType": "multiplicative",
             "gmresMaxIters": 1000,
             "gmresRestart": 1000,
             "gmresRelTol": 1.0e-6,
@@ -497,6 +621,27 @@ class DAOPTION(object):
             "fpMinResTolDiff": 1.0e2,
             "fpPCUpwind": False,
             "dynAdjustTol": False,
+            "useMultiRHS": False,
+            "recycleSize": 0,
+            "useAdjVecCache": False,
+        }
+
+        ## The inexact adjoint controller. If active, the adjoint equation (both Krylov and fixedPoint)
+        ## is converged only to a target relative gradient error instead of the fixed gmresRelTol/fpRelTol.
+        ## The target for each function is funcChangeScale * |F_k - F_k-1| / |F_k|, where F_k is the
+        ## function value of the current optimization iteration, bounded by gradRelTolMin and gradRelTolMax.
+        ## So the early optimization iterations, where the functions change a lot, get cheap adjoints,
+        ## and the tolerance becomes tighter as the optimization converges. The first iteration uses
+        ## gradRelTolMax. If the right-hand side has multiple functions, we use the smallest target.
+        ## The achieved gradient error is estimated as safetyFactor * ||r|| / ||b|| and by the
+        ## dual-weighted residual |r^T psi| / |b^T psi|, where r is the adjoint residual and b is dFdW.
+        ## The tolerance is never tighter than gmresRelTol/gmresAbsTol or fpRelTol.
+        self.inexactAdjoint = {
+            "active": False,
+            "gradRelTolMin": 1.0e-6,
+            "gradRelTolMax": 1.0e-2,
+            "funcChangeScale": 1.0,
+            "safetyFactor": 10.0,
         }
 
         ## Normalization for residuals. We should normalize all residuals!
@@ -719,9 +864,27 @@ class PYDAFOAM(object):
         # a KSP object which may be used outside of the pyDAFoam class
         self.ksp = None
 
+        # the nonzero function seeds from the latest reverse-mode jacvec product in DAFoamFunctions,
+        # e.g., {"CD": 1.0}. This is used to reuse the multi-RHS adjoint solutions
+        self.functionSeeds = {}
+
+        # the function values of the last two primal solutions, e.g., {"CD": [0.021, 0.020]}.
+        # This is used by the inexact adjoint controller, see calcInexactAdjointTol
+        self.functionHist = {}
+
         # a flag used in deformDynamicMesh for runMode=runOnce
         self.dynamicMeshDeformed = 0
 
+        # the state snapshots for the unsteady adjoint checkpointing, {timeIndex: [w, w0, w00]}
+        # NOTE: the snapshots will be file names instead of arrays if checkpointOnDisk is True
+        self.checkpoints = None
+        # the time indices of the snapshots that will never be removed, i.e., the start and end times
+        self.pinnedCheckpoints = []
+        # the time indices of the snapshots saved during the unsteady primal, see initCheckpoints
+        self.forwardCheckpoints = []
+        # the number of time steps recomputed in restoreCheckpoint since the last initCheckpoints
+        self.nRecomputeSteps = 0
+
         if self.getOption("tensorflow")["active"]:
             TensorFlowHelper.options = self.getOption("tensorflow")
             TensorFlowHelper.initialize()
@@ -732,6 +895,10 @@ class PYDAFOAM(object):
             self.solverAD.initTensorFlowFuncs(
                 TensorFlowHelper.predict, TensorFlowHelper.calcJacVecProd, TensorFlowHelper.setModelName
             )
+            if self.solverADF is not None:
+                self.solverADF.initTensorFlowFuncs(
+                    TensorFlowHelper.predict, TensorFlowHelper.calcJacVecProd, TensorFlowHelper.setModelName
+                )
 
         if self.getOption("printDAOptions"):
             self.solver.printAllOptions()
@@ -759,6 +926,10 @@ class PYDAFOAM(object):
 
         Info("Running Primal Solver %03d" % self.nSolvePrimals)
 
+        # write the profile of the previous primal solution and its derivative computation
+        if self.getOption("profiling")["active"] and self.nSolvePrimals > 1:
+            self.writeProfile(self.nSolvePrimals - 1)
+
         self.deletePrevPrimalSolTime()
 
         # self.primalFail: if the primal solution fails, assigns 1, otherwise 0
@@ -855,6 +1026,20 @@ class PYDAFOAM(object):
                         % (objKey, patchName, self.boundaries.keys())
                     )
 
+        checkpointMode = self.getOption("unsteadyAdjoint")["checkpointMode"]
+        if checkpointMode not in ["None", "binomial", "memory"]:
+            raise Error(
+                "unsteadyAdjoint-checkpointMode: %s not supported. Options are: None, binomial, or memory"
+                % checkpointMode
+            )
+        if checkpointMode != "None":
+            if self.getOption("dynamicMesh")["active"]:
+                raise Error("unsteadyAdjoint-checkpointMode does not support dynamicMesh!")
+            if self.getOption("unsteadyAdjoint")["nCheckpoints"] < 1:
+                raise Error("unsteadyAdjoint-nCheckpoints should be at least 1!")
+            if self.getOption("unsteadyAdjoint")["stateCompression"] not in ["None", "lossless", "quantize"]:
+                raise Error("unsteadyAdjoint-stateCompression only supports None, lossless, or quantize!")
+
         # check other combinations...
 
     def calcPrimalResidualStatistics(self, mode):
@@ -895,8 +1080,50 @@ class PYDAFOAM(object):
                 functionValue = self.solver.getTimeOpFuncVal(funcName)
             funcs[funcName] = functionValue
 
+            # save the function history for the inexact adjoint. evalFunctions can be called
+            # multiple times for the same primal solution, so we only save the changed values
+            hist = self.functionHist.setdefault(funcName, [])
+            if len(hist) == 0 or functionValue != hist[-1]:
+                hist.append(functionValue)
+                if len(hist) > 2:
+                    hist.pop(0)
+
         return
 
+    def calcInexactAdjointTol(self):
+        """
+        Compute the target relative gradient error for the inexact adjoint based on the relative
+        change of the function values between the last two optimization iterations. The functions
+        with nonzero seeds (self.functionSeeds) are considered; if there is none, all functions are
+        considered. Return -1 if the inexact adjoint is not active
+        """
+
+        inexactAdjoint = self.getOption("inexactAdjoint")
+        if not inexactAdjoint["active"]:
+            return -1.0
+
+        tolMin = inexactAdjoint["gradRelTolMin"]
+        tolMax = inexactAdjoint["gradRelTolMax"]
+
+        funcNames = list(self.functionSeeds.keys())
+        if len(funcNames) == 0:
+            funcNames = list(self.getOption("function").keys())
+
+        gradRelTol = tolMax
+        for funcName in funcNames:
+            hist = self.functionHist.get(funcName, [])
+            if len(hist) < 2:
+                funcTol = tolMax
+            else:
+                relChange = abs(hist[-1] - hist[-2]) / max(abs(hist[-1]), 1e-16)
+                funcTol = inexactAdjoint["funcChangeScale"] * relChange
+            funcTol = min(max(funcTol, tolMin), tolMax)
+            gradRelTol = min(gradRelTol, funcTol)
+
+        Info("Inexact adjoint target relative gradient error: %g" % gradRelTol)
+
+        return gradRelTol
+
     def addFamilyGroup(self, groupName, families):
         """
         Add a custom grouping of families called groupName. The groupName
@@ -1235,8 +1462,12 @@ class PYDAFOAM(object):
             index_2 = timeIndex - 2
             self.solver.setTime(time_2, index_2)
             self.solver.readMeshPoints(time_2)
-            self.solverAD.setTime(time_2, index_2)
-            self.solverAD.readMeshPoints(time_2)
+            if self.solverAD is not self.solver:
+                self.solverAD.setTime(time_2, index_2)
+                self.solverAD.readMeshPoints(time_2)
+            if self.solverADF is not None:
+                self.solverADF.setTime(time_2, index_2)
+                self.solverADF.readMeshPoints(time_2)
         else:
             raise Error("ddtSchemeOrder not supported")
 
@@ -1245,37 +1476,312 @@ class PYDAFOAM(object):
         index_1 = timeIndex - 1
         self.solver.setTime(time_1, index_1)
         self.solver.readMeshPoints(time_1)
-        self.solverAD.setTime(time_1, index_1)
-        self.solverAD.readMeshPoints(time_1)
+        if self.solverAD is not self.solver:
+            self.solverAD.setTime(time_1, index_1)
+            self.solverAD.readMeshPoints(time_1)
+        if self.solverADF is not None:
+            self.solverADF.setTime(time_1, index_1)
+            self.solverADF.readMeshPoints(time_1)
         # read timeVal points
         self.solver.setTime(timeVal, timeIndex)
         self.solver.readMeshPoints(timeVal)
-        self.solverAD.setTime(timeVal, timeIndex)
-        self.solverAD.readMeshPoints(timeVal)
+        if self.solverAD is not self.solver:
+            self.solverAD.setTime(timeVal, timeIndex)
+            self.solverAD.readMeshPoints(timeVal)
+        if self.solverADF is not None:
+            self.solverADF.setTime(timeVal, timeIndex)
+            self.solverADF.readMeshPoints(timeVal)
 
     def readStateVars(self, timeVal, deltaT):
         """
         Read the state variables in to OpenFOAM's state fields
         """
 
+        # if checkpointing is active, we restore the states from the snapshots and
+        # recompute the primal if needed, instead of reading them from the disk
+        if self.checkpoints is not None:
+            self.restoreCheckpoint(round(timeVal / deltaT), deltaT)
+            return
+
+        # if the states are saved in memory, we fetch the three time levels from the state store
+        # and assign them to all the solvers, without reading them from the disk
+        if self.getOption("unsteadyAdjoint")["checkpointMode"] == "memory":
+            timeIndex = round(timeVal / deltaT)
+            if self.solver.hasStoredStates(timeIndex):
+                states = np.zeros(self.getNLocalAdjointStates())
+                for level in range(3):
+                    # the old time level of the initial time is saved as the time index -1
+                    self.solver.getStoredStates(max(timeIndex - level, -1), states)
+                    self.solver.updateOFFieldsTimeLevel(states, level)
+                    if self.solverAD is not self.solver:
+                        self.solverAD.updateOFFieldsTimeLevel(states, level)
+                    if self.solverADF is not None:
+                        self.solverADF.updateOFFieldsTimeLevel(states, level)
+                return
+            elif timeIndex > 0 and not self.getOption("unsteadyAdjoint")["checkpointWriteStates"]:
+                # the initial states are always read from the disk, e.g., for readZeroFields
+                raise Error(
+                    "States for time index %d not found in memory and they are not written to the disk. "
+                    % timeIndex
+                    + "Set unsteadyAdjoint-checkpointWriteStates to True to read them from the disk!"
+                )
+
         # read current time
         self.solver.readStateVars(timeVal, 0)
-        self.solverAD.readStateVars(timeVal, 0)
+        if self.solverAD is not self.solver:
+            self.solverAD.readStateVars(timeVal, 0)
+        if self.solverADF is not None:
+            self.solverADF.readStateVars(timeVal, 0)
 
         # read old time
         t0 = timeVal - deltaT
         self.solver.readStateVars(t0, 1)
-        self.solverAD.readStateVars(t0, 1)
+        if self.solverAD is not self.solver:
+            self.solverAD.readStateVars(t0, 1)
+        if self.solverADF is not None:
+            self.solverADF.readStateVars(t0, 1)
 
         # read old old time
         t00 = timeVal - 2 * deltaT
         self.solver.readStateVars(t00, 2)
-        self.solverAD.readStateVars(t00, 2)
+        if self.solverAD is not self.solver:
+            self.solverAD.readStateVars(t00, 2)
+        if self.solverADF is not None:
+            self.solverADF.readStateVars(t00, 2)
 
         # assign the state from OF field to wVec so that the wVec
         # is update to date for unsteady adjoint
         # self.solver.ofField2StateVec(self.wVec)
 
+    def initCheckpoints(self):
+        """
+        Initialize the checkpoints for the unsteady adjoint and save the initial states. This
+        needs to be called right before the unsteady primal solution. This is only needed for
+        checkpointMode = binomial. For None, the states will be read from the disk, and for memory,
+        the states are saved to the state store in the C++ layer during the primal solution.
+        For binomial, we also tell the C++ layer which time steps to save during the primal, such
+        that the snapshots of the first binomial sweep are placed in the forward run, see
+        finalizeCheckpoints
+        """
+
+        if self.getOption("unsteadyAdjoint")["checkpointMode"] != "binomial":
+            return
+
+        # remove the snapshots from a previous primal run
+        self.clearCheckpoints()
+        self.checkpoints = {}
+        self.pinnedCheckpoints = []
+        self.nRecomputeSteps = 0
+
+        # the unsteady primal always starts from the time index 0
+        self.saveCheckpoint(0, pin=True)
+
+        # each snapshot needs the states at timeIndex and the two old time levels
+        nInstances = round(self.solver.getEndTime() / self.solver.getDeltaT())
+        self.forwardCheckpoints = self._calcForwardCheckpointIndices(nInstances)
+        for timeIndex in self.forwardCheckpoints:
+            for level in range(3):
+                self.solver.addCheckpointSaveIndex(timeIndex - level)
+
+    def finalizeCheckpoints(self):
+        """
+        Move the snapshots saved in the C++ state store during the unsteady primal to the checkpoints
+        (in memory or on the disk, depending on checkpointOnDisk) and save the end time states.
+        This needs to be called right after the unsteady primal solution
+        """
+
+        if self.checkpoints is None:
+            return
+
+        localAdjSize = self.getNLocalAdjointStates()
+        for timeIndex in self.forwardCheckpoints:
+            snapshot = []
+            for level in range(3):
+                states = np.zeros(localAdjSize)
+                # the old time level of the initial time is saved as the time index -1
+                self.solver.getStoredStates(max(timeIndex - level, -1), states)
+                snapshot.append(states)
+            self._addCheckpoint(timeIndex, snapshot)
+        self.solver.clearStateStore()
+
+        # the end time states are the starting point of the backward sweep
+        endTimeIndex = round(self.solver.getEndTime() / self.solver.getDeltaT())
+        self.saveCheckpoint(endTimeIndex, pin=True)
+
+    def clearCheckpoints(self):
+        """
+        Remove all the saved state snapshots and deactivate the checkpointing
+        """
+
+        if self.getOption("unsteadyAdjoint")["checkpointMode"] in ["memory", "binomial"]:
+            self.solver.clearStateStore()
+
+        if self.checkpoints is None:
+            return
+
+        for timeIndex in list(self.checkpoints.keys()):
+            self._removeCheckpoint(timeIndex)
+
+        self.checkpoints = None
+
+    def saveCheckpoint(self, timeIndex, pin=False):
+        """
+        Save the states, including their old time levels, from self.solver to a snapshot
+
+        Parameters
+        ----------
+        timeIndex : int
+            The time index of the snapshot
+
+        pin : bool
+            If True, the snapshot will never be removed, e.g., for the start and end times
+        """
+
+        localAdjSize = self.getNLocalAdjointStates()
+        snapshot = []
+        for level in range(3):
+            states = np.zeros(localAdjSize)
+            self.solver.getOFFieldsTimeLevel(states, level)
+            snapshot.append(states)
+
+        self._addCheckpoint(timeIndex, snapshot, pin)
+
+    def _addCheckpoint(self, timeIndex, snapshot, pin=False):
+        """
+        Add a snapshot [w, w0, w00] to the checkpoints, in memory or on the disk
+        """
+
+        if self.getOption("unsteadyAdjoint")["checkpointOnDisk"]:
+            checkpointDir = os.path.join(os.getcwd(), "checkpoints")
+            if self.comm.rank == 0 and not os.path.isdir(checkpointDir):
+                os.mkdir(checkpointDir)
+            self.comm.Barrier()
+            fileName = os.path.join(checkpointDir, "states_%d_proc%d.npy" % (timeIndex, self.comm.rank))
+            np.save(fileName, np.array(snapshot))
+            self.checkpoints[timeIndex] = fileName
+        else:
+            self.checkpoints[timeIndex] = snapshot
+
+        if pin and timeIndex not in self.pinnedCheckpoints:
+            self.pinnedCheckpoints.append(timeIndex)
+
+    def _removeCheckpoint(self, timeIndex):
+        """
+        Remove a snapshot from the checkpoints
+        """
+        snapshot = self.checkpoints.pop(timeIndex)
+        if isinstance(snapshot, str) and os.path.isfile(snapshot):
+            os.remove(snapshot)
+        if timeIndex in self.pinnedCheckpoints:
+            self.pinnedCheckpoints.remove(timeIndex)
+
+    def _loadCheckpoint(self, timeIndex):
+        """
+        Return the states of a snapshot as a list of arrays [w, w0, w00]
+        """
+        snapshot = self.checkpoints[timeIndex]
+        if isinstance(snapshot, str):
+            snapshot = list(np.load(snapshot))
+        return snapshot
+
+    def _calcCheckpointStepSize(self, nSteps, nFree):
+        """
+        Calculate how many steps to advance before taking the next snapshot when reversing
+        nSteps time steps with nFree available snapshots. This follows the binomial schedule from
+        Griewank and Walther, Algorithm 799: revolve, ACM TOMS, 2000. Here beta(s, r) = (s+r)!/(s!r!)
+        is the max number of steps that can be reversed with s snapshots and r recomputations per step.
+        We first find the min r such that beta(s, r) >= nSteps, and then advance
+        nSteps - beta(s-1, r) steps such that the rest of the steps can be reversed using s-1 snapshots
+        """
+        r = 0
+        while comb(nFree + r, nFree) < nSteps:
+            r += 1
+
+        return max(1, nSteps - comb(nFree - 1 + r, nFree - 1))
+
+    def _calcForwardCheckpointIndices(self, nInstances):
+        """
+        Calculate the time indices of the snapshots to save during the unsteady primal. The
+        backward sweep starts from the pinned end time snapshot and first restores the time
+        index nInstances - 1, so we place the snapshots exactly as restoreCheckpoint would
+        do when recomputing from the initial time to nInstances - 1. This way, the first
+        backward step only recomputes from the last forward snapshot instead of re-advancing
+        the whole time range
+        """
+
+        nCheckpoints = self.getOption("unsteadyAdjoint")["nCheckpoints"]
+
+        timeIndices = []
+        startIndex = 0
+        targetIndex = nInstances - 1
+        while startIndex < targetIndex:
+            nFree = nCheckpoints - len(timeIndices)
+            nSteps = targetIndex - startIndex
+            if nFree <= 0 or nSteps <= 1:
+                break
+            startIndex += self._calcCheckpointStepSize(nSteps, nFree)
+            if startIndex < targetIndex:
+                timeIndices.append(startIndex)
+
+        return timeIndices
+
+    def restoreCheckpoint(self, timeIndex, deltaT):
+        """
+        Assign the states at timeIndex, including their old time levels, to the OpenFOAM layer.
+        We first find the closest snapshot before timeIndex and then recompute the primal from there.
+        In the meantime, we save new snapshots based on the binomial schedule if there are available
+        slots. Because the unsteady adjoint sweeps backward in time, all the unpinned snapshots after
+        timeIndex will not be needed anymore, so we remove them to free the slots
+
+        Parameters
+        ----------
+        timeIndex : int
+            The time index to restore the states
+
+        deltaT : float
+            The time step
+        """
+
+        nCheckpoints = self.getOption("unsteadyAdjoint")["nCheckpoints"]
+
+        for idx in list(self.checkpoints.keys()):
+            if idx > timeIndex and idx not in self.pinnedCheckpoints:
+                self._removeCheckpoint(idx)
+
+        startIndex = max([idx for idx in self.checkpoints.keys() if idx <= timeIndex])
+
+        # assign the snapshot to self.solver. NOTE: we need to assign the current time level
+        # first, otherwise, OpenFOAM will overwrite the old time levels when updating the current one
+        snapshot = self._loadCheckpoint(startIndex)
+        self.solver.setTime(startIndex * deltaT, startIndex)
+        for level in range(3):
+            self.solver.updateOFFieldsTimeLevel(snapshot[level], level)
+
+        # recompute the primal to timeIndex and save new snapshots on the way
+        while startIndex < timeIndex:
+            nFree = nCheckpoints - (len(self.checkpoints) - len(self.pinnedCheckpoints))
+            nSteps = timeIndex - startIndex
+            endIndex = timeIndex
+            if nFree > 0 and nSteps > 1:
+                endIndex = startIndex + self._calcCheckpointStepSize(nSteps, nFree)
+            fail = self.solver.recomputePrimal(startIndex, endIndex)
+            self.nRecomputeSteps += endIndex - startIndex
+            if fail:
+                raise Error("Primal recomputation failed from time index %d to %d" % (startIndex, endIndex))
+            if endIndex < timeIndex:
+                self.saveCheckpoint(endIndex)
+            startIndex = endIndex
+
+        # now self.solver has the states at timeIndex. Transfer them to the AD solvers
+        localAdjSize = self.getNLocalAdjointStates()
+        states = np.zeros(localAdjSize)
+        for level in range(3):
+            self.solver.getOFFieldsTimeLevel(states, level)
+            if self.solverAD is not self.solver:
+                self.solverAD.updateOFFieldsTimeLevel(states, level)
+            if self.solverADF is not None:
+                self.solverADF.updateOFFieldsTimeLevel(states, level)
+
     def set_solver_input(self, inputs, DVGeo=None):
         """
         Set solver input. If it is forward mode, we also set the seeds
@@ -1300,7 +1806,11 @@ class PYDAFOAM(object):
 
             # here we need to update the solver input for both solver and solverAD
             self.solver.setSolverInput(inputName, inputType, inputSize, input, seeds)
-            self.solverAD.setSolverInput(inputName, inputType, inputSize, input, seeds)
+            if self.solverAD is not self.solver:
+                self.solverAD.setSolverInput(inputName, inputType, inputSize, input, seeds)
+            # NOTE: the ADF solver is used for dRdWTPC only, so we always use zero seeds for it
+            if self.solverADF is not None:
+                self.solverADF.setSolverInput(inputName, inputType, inputSize, input, np.zeros(inputSize))
 
     def calcFFD2XvSeeds(self, DVGeo=None):
         # Calculate the FFD2XvSeed array:
@@ -1356,7 +1866,13 @@ class PYDAFOAM(object):
 
         from .libs.pyDASolvers import pyDASolvers
 
-        self.solver = pyDASolvers(solverArg.encode(), self.options)
+        if self.getOption("useSingleSolverInstance") and self.getOption("useAD")["mode"] != "reverse":
+            raise Error("useSingleSolverInstance is only supported for useAD-mode = reverse!")
+
+        # if useSingleSolverInstance is True, self.solver points to self.solverAD, which
+        # is created below
+        if not self.getOption("useSingleSolverInstance"):
+            self.solver = pyDASolvers(solverArg.encode(), self.options)
 
         if self.getOption("useAD")["mode"] == "forward":
 
@@ -1370,8 +1886,33 @@ class PYDAFOAM(object):
 
             self.solverAD = pyDASolversAD(solverArg.encode(), self.options)
 
+        # the ADR solver runs the primal with the tape passive, and there is no need to
+        # sync the states and mesh between self.solver and self.solverAD
+        if self.getOption("useSingleSolverInstance"):
+            self.solver = self.solverAD
+
+        # the solver object to compute the dRdWTPC matrix. If adjPartDerivMethod = forwardAD,
+        # we need an additional ADF solver to compute the exact partial derivatives
+        self.solverADF = None
+        self.solverPC = self.solver
+        if self.getOption("adjPartDerivMethod") == "forwardAD" and self.getOption("useAD")["mode"] == "reverse":
+
+            from .libs.ADF.pyDASolvers import pyDASolvers as pyDASolversADF
+
+            self.solverADF = pyDASolversADF(solverArg.encode(), self.options)
+            self.solverPC = self.solverADF
+
+            if self.getOption("useSingleSolverInstance"):
+                Info(
+                    "Warning: adjPartDerivMethod = forwardAD creates an additional ADF solver, which holds "
+                    + "another copy of the mesh and fields and offsets the memory saved by useSingleSolverInstance"
+                )
+
         self.solver.initSolver()
-        self.solverAD.initSolver()
+        if self.solverAD is not self.solver:
+            self.solverAD.initSolver()
+        if self.solverADF is not None:
+            self.solverADF.initSolver()
 
         Info("Init solver done! ElapsedClockTime %f s" % self.solver.getElapsedClockTime())
         Info("Init solver done! ElapsedCpuTime %f s" % self.solver.getElapsedCpuTime())
@@ -1433,6 +1974,60 @@ class PYDAFOAM(object):
 
         return
 
+    def writeProfile(self, solIndex=None):
+        """
+        Write the profiling data of all solver libraries (NoAD, ADR, and ADF) to
+        outputDir/profile_XXX.json, then reset the profiling data. This needs to be called
+        by all processors
+
+        Parameters
+        ----------
+        solIndex : int
+            The index of the json file, the default is the latest primal solution index
+
+        Returns
+        -------
+        profile : dict
+            The profiling data, e.g., profile["ADR"]["regions"]["kspSolve"]["max"]
+        """
+
+        import json
+
+        if solIndex is None:
+            solIndex = self.nSolvePrimals - 1
+
+        outputDir = self.getOption("profiling")["outputDir"]
+        if self.comm.rank == 0 and not os.path.isdir(outputDir):
+            os.makedirs(outputDir)
+        self.comm.Barrier()
+
+        # each solver library has its own profiler, so we need to write all of them
+        solvers = []
+        for solver in [self.solver, getattr(self, "solverAD", None), self.solverADF]:
+            if solver is not None and all(solver is not s for s in solvers):
+                solvers.append(solver)
+
+        fileNames = []
+        for idxI, solver in enumerate(solvers):
+            fileName = os.path.join(outputDir, "profile_%03d_%d.json" % (solIndex, idxI))
+            solver.writeProfile(fileName)
+            solver.resetProfile()
+            fileNames.append(fileName)
+
+        # merge the files from the solver libraries into one file
+        profile = {}
+        if self.comm.rank == 0:
+            for fileName in fileNames:
+                with open(fileName, "r") as f:
+                    data = json.load(f)
+                profile[data.pop("build")] = data
+                os.remove(fileName)
+            with open(os.path.join(outputDir, "profile_%03d.json" % solIndex), "w") as f:
+                json.dump(profile, f, indent=4)
+        profile = self.comm.bcast(profile, root=0)
+
+        return profile
+
     def renameSolution(self, solIndex):
         """
         Rename the primal solution folder to specific format for post-processing. The renamed time has the
@@ -1589,7 +2184,10 @@ class PYDAFOAM(object):
         Assign the boundary condition defined in primalBC to the OF fields
         """
         self.solver.setPrimalBoundaryConditions(printInfo)
-        self.solverAD.setPrimalBoundaryConditions(printInfoAD)
+        if self.solverAD is not self.solver:
+            self.solverAD.setPrimalBoundaryConditions(printInfoAD)
+        if self.solverADF is not None:
+            self.solverADF.setPrimalBoundaryConditions(printInfoAD)
 
     def _computeBasicFamilyInfo(self):
         """
@@ -1992,9 +2590,12 @@ class PYDAFOAM(object):
 
         self.solver.updateDAOption(self.options)
 
-        if self.getOption("useAD")["mode"] in ["forward", "reverse"]:
+        if self.getOption("useAD")["mode"] in ["forward", "reverse"] and self.solverAD is not self.solver:
             self.solverAD.updateDAOption(self.options)
 
+        if self.solverADF is not None:
+            self.solverADF.updateDAOption(self.options)
+
     def getNLocalAdjointStates(self):
         """
         Get number of local adjoint states
@@ -2024,7 +2625,10 @@ class PYDAFOAM(object):
         """
 
         self.solver.updateOFFields(states)
-        self.solverAD.updateOFFields(states)
+        if self.solverAD is not self.solver:
+            self.solverAD.updateOFFields(states)
+        if self.solverADF is not None:
+            self.solverADF.updateOFFields(states)
 
         return
 
@@ -2034,7 +2638,10 @@ class PYDAFOAM(object):
         """
 
         self.solver.updateOFMesh(vol_coords)
-        self.solverAD.updateOFMesh(vol_coords)
+        if self.solverAD is not self.solver:
+            self.solverAD.updateOFMesh(vol_coords)
+        if self.solverADF is not None:
+            self.solverADF.updateOFMesh(vol_coords)
 
         return
 
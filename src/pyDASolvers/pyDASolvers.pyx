@@ -14,6 +14,7 @@
 
 # for using Petsc
 from petsc4py.PETSc cimport Vec, PetscVec, Mat, PetscMat, KSP, PetscKSP
+from libc.stdlib cimport malloc, free
 cimport numpy as np
 np.import_array() # initialize C API to call PyArray_SimpleNewFromData
 
@@ -49,6 +50,16 @@ cdef extern from "DASolvers.H" namespace "Foam":
         int solvePrimal()
         void runColoring()
         void calcJacTVecProduct(char *, char *, double *, char *, char *, double *, double *)
+        void tapeSessionBegin()
+        void tapeSessionAddInput(char *, char *, double *)
+        void tapeSessionRecord()
+        void tapeSessionSetResidualSeed(double *)
+        void tapeSessionSetFunctionSeed(char *, double)
+        void tapeSessionEvaluate()
+        void tapeSessionGetStateGradient(int, double *)
+        void tapeSessionGetInputGradient(char *, double *)
+        void tapeSessionClearAdjoints()
+        void tapeSessionFinish()
         int getInputSize(char *, char *)
         int getOutputSize(char *, char *)
         void calcOutput(char *, char *, double *)
@@ -61,9 +72,22 @@ cdef extern from "DASolvers.H" namespace "Foam":
         void createMLRKSPMatrixFree(PetscMat, PetscKSP)
         void updateKSPPCMat(PetscMat, PetscKSP)
         int solveLinearEqn(PetscKSP, PetscVec, PetscVec)
+        int solveLinearEqnMultiRHS(PetscKSP, int, PetscVec *, PetscVec *)
+        void setInexactAdjointTol(double)
         void calcdRdWOldTPsiAD(int, double *, double *)
         void updateOFFields(double *)
         void getOFFields(double *)
+        void updateOFFieldsTimeLevel(double *, int)
+        void getOFFieldsTimeLevel(double *, int)
+        int recomputePrimal(int, int)
+        int hasStoredStates(int)
+        void getStoredStates(int, double *)
+        void clearStateStore()
+        void addCheckpointSaveIndex(int)
+        void writeProfile(char *)
+        void resetProfile()
+        double getProfileTime(char *)
+        int getProfileCount(char *)
         void getOFField(char *, char *, double *)
         void getOFMeshPoints(double *)
         void updateOFMesh(double *)
@@ -77,7 +101,9 @@ cdef extern from "DASolvers.H" namespace "Foam":
         double getTimeOpFuncVal(char *)
         double getElapsedClockTime()
         double getElapsedCpuTime()
-        void calcCouplingFaceCoords(double *, double *)
+        void calcCouplingFaceCoords(double *, int, double *)
+        void calcDevRhoReffBoundaryCheck(double *)
+        void calcSourcePreaccumulationCheck(double *)
         int getNRegressionParameters(char *)
         void printAllOptions()
         void updateDAOption(object)
@@ -94,6 +120,7 @@ cdef extern from "DASolvers.H" namespace "Foam":
         void readMeshPoints(double)
         void writeMeshPoints(double *, double)
         void calcPCMatWithFvMatrix(PetscMat, int)
+        void getPCMatSlotColorStats(double *)
         double getEndTime()
         double getDeltaT()
         void setTime(double, int)
@@ -219,6 +246,43 @@ cdef class pyDASolvers:
             seeds_data, 
             product_data)
     
+    def tapeSessionBegin(self):
+        self._thisptr.tapeSessionBegin()
+    
+    def tapeSessionAddInput(self, inputName, inputType, np.ndarray[double, ndim=1, mode="c"] inputs):
+        assert len(inputs) == self.getInputSize(inputName, inputType), "invalid input array size!"
+        cdef double *inputs_data = <double*>inputs.data
+        self._thisptr.tapeSessionAddInput(inputName.encode(), inputType.encode(), inputs_data)
+    
+    def tapeSessionRecord(self):
+        self._thisptr.tapeSessionRecord()
+    
+    def tapeSessionSetResidualSeed(self, np.ndarray[double, ndim=1, mode="c"] seeds):
+        assert len(seeds) == self.getNLocalAdjointStates(), "invalid seed array size!"
+        cdef double *seeds_data = <double*>seeds.data
+        self._thisptr.tapeSessionSetResidualSeed(seeds_data)
+    
+    def tapeSessionSetFunctionSeed(self, functionName, seed):
+        self._thisptr.tapeSessionSetFunctionSeed(functionName.encode(), seed)
+    
+    def tapeSessionEvaluate(self):
+        self._thisptr.tapeSessionEvaluate()
+    
+    def tapeSessionGetStateGradient(self, oldTimeLevel, np.ndarray[double, ndim=1, mode="c"] product):
+        assert len(product) == self.getNLocalAdjointStates(), "invalid product array size!"
+        cdef double *product_data = <double*>product.data
+        self._thisptr.tapeSessionGetStateGradient(oldTimeLevel, product_data)
+    
+    def tapeSessionGetInputGradient(self, inputName, np.ndarray[double, ndim=1, mode="c"] product):
+        cdef double *product_data = <double*>product.data
+        self._thisptr.tapeSessionGetInputGradient(inputName.encode(), product_data)
+    
+    def tapeSessionClearAdjoints(self):
+        self._thisptr.tapeSessionClearAdjoints()
+    
+    def tapeSessionFinish(self):
+        self._thisptr.tapeSessionFinish()
+    
     def calcdRdWT(self, isPC, Mat dRdWT):
         self._thisptr.calcdRdWT(isPC, dRdWT.mat)
     
@@ -250,6 +314,30 @@ cdef class pyDASolvers:
     def solveLinearEqn(self, KSP myKSP, Vec rhsVec, Vec solVec):
         return self._thisptr.solveLinearEqn(myKSP.ksp, rhsVec.vec, solVec.vec)
     
+    def solveLinearEqnMultiRHS(self, KSP myKSP, rhsVecs, solVecs):
+        assert len(rhsVecs) == len(solVecs), "invalid vec list size!"
+
+        cdef int nRHS = len(rhsVecs)
+        cdef PetscVec *rhs_data = <PetscVec*>malloc(nRHS * sizeof(PetscVec))
+        cdef PetscVec *sol_data = <PetscVec*>malloc(nRHS * sizeof(PetscVec))
+        cdef Vec vecI
+
+        for i in range(nRHS):
+            vecI = rhsVecs[i]
+            rhs_data[i] = vecI.vec
+            vecI = solVecs[i]
+            sol_data[i] = vecI.vec
+
+        nFails = self._thisptr.solveLinearEqnMultiRHS(myKSP.ksp, nRHS, rhs_data, sol_data)
+
+        free(rhs_data)
+        free(sol_data)
+
+        return nFails
+    
+    def setInexactAdjointTol(self, gradRelTol):
+        self._thisptr.setInexactAdjointTol(gradRelTol)
+    
     def updateOFFields(self, np.ndarray[double, ndim=1, mode="c"] states):
         assert len(states) == self.getNLocalAdjointStates(), "invalid array size!"
         cdef double *states_data = <double*>states.data
@@ -260,6 +348,45 @@ cdef class pyDASolvers:
         cdef double *states_data = <double*>states.data
         self._thisptr.getOFFields(states_data)
     
+    def updateOFFieldsTimeLevel(self, np.ndarray[double, ndim=1, mode="c"] states, oldTimeLevel):
+        assert len(states) == self.getNLocalAdjointStates(), "invalid array size!"
+        cdef double *states_data = <double*>states.data
+        self._thisptr.updateOFFieldsTimeLevel(states_data, oldTimeLevel)
+    
+    def getOFFieldsTimeLevel(self, np.ndarray[double, ndim=1, mode="c"] states, oldTimeLevel):
+        assert len(states) == self.getNLocalAdjointStates(), "invalid array size!"
+        cdef double *states_data = <double*>states.data
+        self._thisptr.getOFFieldsTimeLevel(states_data, oldTimeLevel)
+    
+    def recomputePrimal(self, startTimeIndex, endTimeIndex):
+        return self._thisptr.recomputePrimal(startTimeIndex, endTimeIndex)
+    
+    def hasStoredStates(self, timeIndex):
+        return self._thisptr.hasStoredStates(timeIndex)
+    
+    def getStoredStates(self, timeIndex, np.ndarray[double, ndim=1, mode="c"] states):
+        assert len(states) == self.getNLocalAdjointStates(), "invalid array size!"
+        cdef double *states_data = <double*>states.data
+        self._thisptr.getStoredStates(timeIndex, states_data)
+    
+    def clearStateStore(self):
+        self._thisptr.clearStateStore()
+    
+    def addCheckpointSaveIndex(self, timeIndex):
+        self._thisptr.addCheckpointSaveIndex(timeIndex)
+    
+    def writeProfile(self, fileName):
+        self._thisptr.writeProfile(fileName.encode())
+    
+    def resetProfile(self):
+        self._thisptr.resetProfile()
+    
+    def getProfileTime(self, regionName):
+        return self._thisptr.getProfileTime(regionName.encode())
+    
+    def getProfileCount(self, regionName):
+        return self._thisptr.getProfileCount(regionName.encode())
+    
     def getOFMeshPoints(self, np.ndarray[double, ndim=1, mode="c"] points):
         assert len(points) == self.getNLocalPoints() * 3, "invalid array size!"
         cdef double *points_data = <double*>points.data
@@ -317,7 +444,23 @@ cdef class pyDASolvers:
         cdef double *volCoords_data = <double*>volCoords.data
         cdef double *surfCoords_data = <double*>surfCoords.data
 
-        self._thisptr.calcCouplingFaceCoords(volCoords_data, surfCoords_data)
+        self._thisptr.calcCouplingFaceCoords(volCoords_data, len(surfCoords), surfCoords_data)
+
+    def calcDevRhoReffBoundaryCheck(self, np.ndarray[double, ndim=1, mode="c"] checkVals):
+
+        assert len(checkVals) == 4, "invalid array size!"
+
+        cdef double *checkVals_data = <double*>checkVals.data
+
+        self._thisptr.calcDevRhoReffBoundaryCheck(checkVals_data)
+
+    def calcSourcePreaccumulationCheck(self, np.ndarray[double, ndim=1, mode="c"] checkVals):
+
+        assert len(checkVals) == 4, "invalid array size!"
+
+        cdef double *checkVals_data = <double*>checkVals.data
+
+        self._thisptr.calcSourcePreaccumulationCheck(checkVals_data)
 
     def getNRegressionParameters(self, modelName):
         return self._thisptr.getNRegressionParameters(modelName)
@@ -361,6 +504,14 @@ cdef class pyDASolvers:
     def calcPCMatWithFvMatrix(self, Mat PCMat, turbOnly=0):
         self._thisptr.calcPCMatWithFvMatrix(PCMat.mat, turbOnly)
     
+    def getPCMatSlotColorStats(self, np.ndarray[double, ndim=1, mode="c"] stats):
+
+        assert len(stats) == 2, "invalid array size!"
+
+        cdef double *stats_data = <double*>stats.data
+
+        self._thisptr.getPCMatSlotColorStats(stats_data)
+    
     def setTime(self, time, timeIndex):
         self._thisptr.setTime(time, timeIndex)
 
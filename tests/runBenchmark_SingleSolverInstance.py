@@ -0,0 +1,133 @@
+#!/usr/bin/env python
+"""
+Benchmark the primal runtime and memory usage with and without useSingleSolverInstance
+
+Usage:
+    python runBenchmark_SingleSolverInstance.py [nProcs]
+
+This script runs itself twice in separate processes, one with the default NoAD + ADR solvers
+and one with useSingleSolverInstance = True, and prints the primal runtime and the peak
+resident memory (summed over all processors) for both. It is not part of the regression tests
+
+NOTE: no timing or memory results have been recorded for this option yet, so the expected
+primal slowdown and memory saving of useSingleSolverInstance are unknown. Run this script on
+the target case before turning the option on for production runs
+"""
+
+import os
+import sys
+import time
+import resource
+import subprocess
+
+# aero setup
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "useAD": {"mode": "reverse"},
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 0.1,
+        },
+    },
+}
+
+
+def getRSSMB():
+    # the current resident memory of this process in MB
+    with open("/proc/self/status") as f:
+        for line in f:
+            if line.startswith("VmRSS:"):
+                return float(line.split()[1]) / 1024.0
+    return 0.0
+
+
+def runBenchmark(mode):
+    from mpi4py import MPI
+    from dafoam import PYDAFOAM
+
+    gcomm = MPI.COMM_WORLD
+
+    os.chdir("./reg_test_files-main/ConvergentChannel")
+    if gcomm.rank == 0:
+        os.system("rm -rf 0/* processor* *.bin")
+        os.system("cp -r 0.incompressible/* 0/")
+        os.system("cp -r system.incompressible/* system/")
+        os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    gcomm.Barrier()
+
+    daOptions["useSingleSolverInstance"] = mode == "single"
+
+    rss0 = getRSSMB()
+    DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+    rssInit = getRSSMB()
+
+    gcomm.Barrier()
+    t0 = time.time()
+    DASolver()
+    gcomm.Barrier()
+    primalTime = time.time() - t0
+
+    funcs = {}
+    DASolver.evalFunctions(funcs)
+
+    # ru_maxrss is in KB on Linux
+    rssPeak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024.0
+    solverRSS = gcomm.allreduce(rssInit - rss0, op=MPI.SUM)
+    rssPeak = gcomm.allreduce(rssPeak, op=MPI.SUM)
+
+    if gcomm.rank == 0:
+        print("Benchmark %s %f %f %f %.12e" % (mode, primalTime, solverRSS, rssPeak, funcs["CD"]), flush=True)
+
+
+if len(sys.argv) > 1 and sys.argv[1] in ["dual", "single"]:
+    runBenchmark(sys.argv[1])
+else:
+    # run the two modes in separate processes so that their memory usages do not mix
+    nProcs = 1
+    if len(sys.argv) > 1:
+        nProcs = int(sys.argv[1])
+
+    results = {}
+    for mode in ["dual", "single"]:
+        command = [sys.executable, os.path.abspath(__file__), mode]
+        if nProcs > 1:
+            command = ["mpirun", "--oversubscribe", "-np", str(nProcs)] + command
+        output = subprocess.run(command, stdout=subprocess.PIPE, universal_newlines=True).stdout
+        for line in output.splitlines():
+            if line.startswith("Benchmark %s " % mode):
+                results[mode] = [float(c) for c in line.split()[2:]]
+
+    if len(results) != 2:
+        print("Benchmark failed! Results: %s" % results)
+        exit(1)
+
+    print("")
+    print("%-8s %16s %20s %18s %20s" % ("mode", "primal time (s)", "solver memory (MB)", "peak memory (MB)", "CD"))
+    for mode in ["dual", "single"]:
+        r = results[mode]
+        print("%-8s %16.2f %20.1f %18.1f %20.12e" % (mode, r[0], r[1], r[2], r[3]))
+    print("")
+
+    dual = results["dual"]
+    single = results["single"]
+    print("Primal slowdown: %.2fx" % (single[0] / dual[0]))
+    print("Solver memory saved: %.1f%%" % (100.0 * (1.0 - single[1] / dual[1])))
+    print("Peak memory saved: %.1f%%" % (100.0 * (1.0 - single[2] / dual[2])))
+    if abs(single[3] - dual[3]) > 1e-8 * abs(dual[3]):
+        print("Warning: CD differs between the two modes!")
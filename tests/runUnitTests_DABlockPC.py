@@ -0,0 +1,81 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the block ILU preconditioner (adjEqnOption-pcMatType = baij)
+
+DAHeatTransferFoam has only one cell state (T) and no surfaceScalarStates, so the PC mat can be a
+BAIJ mat with one block per cell. We solve the same adjoint equation with the aij and baij PC mats
+and check that both converge to the same solution
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import numpy as np
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ChannelConjugateHeatV4/thermal")
+
+daOptions = {
+    "designSurfaces": ["channel_outer", "channel_inner", "channel_sides"],
+    "solverName": "DAHeatTransferFoam",
+    "primalMinResTol": 1e-12,
+    "printDAOptions": False,
+    "adjStateOrdering": "cell",
+    "adjEqnOption": {"gmresRelTol": 1.0e-12, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+}
+
+
+def solveAdjoint(pcMatType):
+    if gcomm.rank == 0:
+        os.system("rm -rf processor* *.bin")
+
+    daOptions["adjEqnOption"]["pcMatType"] = pcMatType
+    DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+    DASolver()
+
+    DASolver.solver.runColoring()
+    DASolver.solverAD.initializedRdWTMatrixFree()
+
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    ksp = PETSc.KSP().create(PETSc.COMM_WORLD)
+    DASolver.solverAD.createMLRKSPMatrixFree(dRdWTPC, ksp)
+
+    nLocalAdjointStates = DASolver.getNLocalAdjointStates()
+    rhs = PETSc.Vec().create(PETSc.COMM_WORLD)
+    rhs.setSizes((nLocalAdjointStates, PETSc.DECIDE), bsize=1)
+    rhs.setFromOptions()
+    rhs.set(1.0)
+    psi = rhs.duplicate()
+    psi.zeroEntries()
+
+    fail = DASolver.solverAD.solveLinearEqn(ksp, rhs, psi)
+    psiArray = DASolver.vec2Array(psi)
+
+    ksp.destroy()
+    dRdWTPC.destroy()
+    DASolver.solverAD.destroydRdWTMatrixFree()
+
+    return fail, psiArray
+
+
+failAIJ, psiAIJ = solveAdjoint("aij")
+failBAIJ, psiBAIJ = solveAdjoint("baij")
+
+diffNorm = gcomm.allreduce(np.linalg.norm(psiBAIJ - psiAIJ) ** 2, op=MPI.SUM) ** 0.5
+refNorm = gcomm.allreduce(np.linalg.norm(psiAIJ) ** 2, op=MPI.SUM) ** 0.5
+print("psi norm aij: ", refNorm, " diff baij: ", diffNorm)
+if failAIJ or failBAIJ:
+    print("DABlockPC test failed! The adjoint does not converge.")
+    exit(1)
+elif diffNorm / (refNorm + 1e-16) > 1e-8:
+    print("DABlockPC test failed!")
+    exit(1)
+else:
+    print("DABlockPC test passed!")
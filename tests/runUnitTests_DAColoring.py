@@ -0,0 +1,68 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the legacy and speculative distance-2 coloring (adjColoringEngine)
+
+We compute the dRdW coloring with each engine on the same mesh. Each coloring is validated by
+the engine that computes it. Then we read the same coloring file with the other engine, which
+validates it again with the other validation, so both colorings are checked by both validations.
+Any coloring conflict raises a fatal error
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+}
+
+
+def readColoring(coloringEngine):
+    # read the existing coloring file in calcdRdWT and validate it
+    daOptions["adjColoringEngine"] = coloringEngine
+    DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    dRdWTPC.destroy()
+
+
+for computeEngine, readEngine in [["legacy", "speculative"], ["speculative", "legacy"]]:
+    if gcomm.rank == 0:
+        os.system("rm -rf dRdWColoring_*.bin")
+    gcomm.Barrier()
+
+    daOptions["adjColoringEngine"] = computeEngine
+    DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+    DASolver.solver.runColoring()
+
+    readColoring(readEngine)
+
+    print("%s coloring validated by both engines!" % computeEngine)
+
+print("DAColoring test passed!")
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the single precision ILU preconditioner (adjEqnOption-pcPrecision = single)
+
+We solve the same adjoint equation with Petsc's ILU (pcPrecision = double) and DAFloatILU
+(pcPrecision = single) using the same fill level and reordering. Both should converge to the same
+solution, and the float factors should not noticeably increase the GMRES iteration count
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import copy
+import numpy as np
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "useAD": {"mode": "reverse"},
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+}
+
+
+def solveAdjoint(pcPrecision, jacMatReOrdering):
+    if gcomm.rank == 0:
+        os.system("rm -rf processor* *.bin")
+
+    options = copy.deepcopy(daOptions)
+    options["adjEqnOption"]["pcPrecision"] = pcPrecision
+    options["adjEqnOption"]["jacMatReOrdering"] = jacMatReOrdering
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+
+    DASolver.solver.runColoring()
+    DASolver.solverAD.initializedRdWTMatrixFree()
+
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    ksp = PETSc.KSP().create(PETSc.COMM_WORLD)
+    DASolver.solverAD.createMLRKSPMatrixFree(dRdWTPC, ksp)
+
+    nLocalAdjointStates = DASolver.getNLocalAdjointStates()
+    rhs = PETSc.Vec().create(PETSc.COMM_WORLD)
+    rhs.setSizes((nLocalAdjointStates, PETSc.DECIDE), bsize=1)
+    rhs.setFromOptions()
+    rhs.set(1.0)
+    psi = rhs.duplicate()
+    psi.zeroEntries()
+
+    fail = DASolver.solverAD.solveLinearEqn(ksp, rhs, psi)
+    nIters = ksp.getIterationNumber()
+    psiArray = DASolver.vec2Array(psi)
+
+    ksp.destroy()
+    dRdWTPC.destroy()
+    DASolver.solverAD.destroydRdWTMatrixFree()
+
+    return fail, nIters, psiArray
+
+
+for jacMatReOrdering in ["rcm", "nd"]:
+    failDouble, nItersDouble, psiDouble = solveAdjoint("double", jacMatReOrdering)
+    failSingle, nItersSingle, psiSingle = solveAdjoint("single", jacMatReOrdering)
+
+    diffNorm = gcomm.allreduce(np.linalg.norm(psiSingle - psiDouble) ** 2, op=MPI.SUM) ** 0.5
+    refNorm = gcomm.allreduce(np.linalg.norm(psiDouble) ** 2, op=MPI.SUM) ** 0.5
+    print(
+        "%s GMRES iterations double: %d single: %d psi diff: %g"
+        % (jacMatReOrdering, nItersDouble, nItersSingle, diffNorm / (refNorm + 1e-16))
+    )
+    if failDouble or failSingle:
+        print("DAFloatILU test failed! The adjoint does not converge.")
+        exit(1)
+    elif diffNorm / (refNorm + 1e-16) > 1e-7:
+        print("DAFloatILU test failed! The adjoint solutions differ.")
+        exit(1)
+    elif nItersSingle > max(1.1 * nItersDouble, nItersDouble + 2):
+        print("DAFloatILU test failed! The single precision PC needs more GMRES iterations.")
+        exit(1)
+
+print("DAFloatILU test passed!")
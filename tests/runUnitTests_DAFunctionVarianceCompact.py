@@ -0,0 +1,126 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the compact reference data file of the variance function
+
+We compute the variance with the ref values read from the full varData fields, then with
+compactRefData. The first compactRefData run writes the compact file and the second one reads it,
+and both should match the full field values. Finally, we modify the pData files and check that
+the compact file is rejected and rewritten
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import copy
+import glob
+import time
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "function": {
+        "PVar": {
+            "type": "variance",
+            "source": "allCells",
+            "scale": 1.0,
+            "mode": "field",
+            "varName": "p",
+            "varType": "scalar",
+            "indices": [0],
+            "timeDependentRefData": False,
+            "compactRefData": 0,
+        },
+        "PProbe": {
+            "type": "variance",
+            "source": "allCells",
+            "scale": 1.0,
+            "mode": "probePoint",
+            "probePointCoords": [[0.51, 0.52, 0.53], [0.2, 0.3, 0.4]],
+            "varName": "p",
+            "varType": "scalar",
+            "indices": [0],
+            "timeDependentRefData": False,
+            "compactRefData": 0,
+        },
+    },
+}
+
+compactFiles = ["processor0/constant/PVar_pDataCompact", "processor0/constant/PProbe_pDataCompact"]
+
+
+def runPrimal(compactRefData):
+    options = copy.deepcopy(daOptions)
+    for funcName in options["function"].keys():
+        options["function"][funcName]["compactRefData"] = compactRefData
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+    funcs = {}
+    DASolver.evalFunctions(funcs)
+    return funcs
+
+
+def getMTimes():
+    mTimes = None
+    if gcomm.rank == 0:
+        mTimes = [os.path.getmtime(fName) for fName in compactFiles]
+    return gcomm.bcast(mTimes, root=0)
+
+
+def checkFuncs(funcs, funcsRef, testName):
+    for funcName in funcsRef.keys():
+        relDiff = abs(funcs[funcName] - funcsRef[funcName]) / (abs(funcsRef[funcName]) + 1e-16)
+        print(testName, funcName, funcs[funcName], funcsRef[funcName])
+        if relDiff > 1e-12:
+            print("DAFunctionVarianceCompact %s test failed!" % testName)
+            exit(1)
+
+
+funcsFull = runPrimal(0)
+
+# the first run writes the compact files
+funcsWrite = runPrimal(1)
+checkFuncs(funcsWrite, funcsFull, "write")
+mTimesWrite = getMTimes()
+
+# the second run reads the compact files, so they should not be rewritten
+time.sleep(1.1)
+funcsRead = runPrimal(1)
+checkFuncs(funcsRead, funcsFull, "read")
+if getMTimes() != mTimesWrite:
+    print("DAFunctionVarianceCompact read test failed! The compact files were rewritten")
+    exit(1)
+
+# modify the pData files, without changing their values, so the compact files should be rejected
+time.sleep(1.1)
+if gcomm.rank == 0:
+    for fName in glob.glob("processor*/0/pData"):
+        with open(fName, "a") as f:
+            f.write("\n// modified\n")
+gcomm.Barrier()
+funcsModified = runPrimal(1)
+checkFuncs(funcsModified, funcsFull, "modified")
+if getMTimes() == mTimesWrite:
+    print("DAFunctionVarianceCompact modified test failed! The compact files were not rewritten")
+    exit(1)
+
+print("DAFunctionVarianceCompact test passed!")
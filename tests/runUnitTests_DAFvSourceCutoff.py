@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the candidate cells of the smoothed actuator disk (cutoffEps)
+
+With cutoffEps > 0, we only loop over the cells within cutoffEps * eps of the disk. The skipped cells
+have negligible source terms, so the primal should match the one with cutoffEps = 0 (all cells) to
+within a small tolerance. We also deform the mesh after the first primal and check that the candidate
+cells are updated, i.e., the deformed primal matches the one computed from scratch on the same mesh
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import copy
+import numpy as np
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-11,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": True,
+    },
+    "fvSource": {
+        "disk": {
+            "type": "actuatorDisk",
+            "source": "cylinderAnnulusSmooth",
+            "center": [0.5, 0.5, 0.5],
+            "direction": [1.0, 0.0, 0.0],
+            "innerRadius": 0.01,
+            "outerRadius": 0.4,
+            "rotDir": "right",
+            "scale": 100.0,
+            "POD": 0.8,
+            "eps": 0.1,
+            "expM": 1.0,
+            "expN": 0.5,
+            "adjustThrust": 0,
+            "targetThrust": 1.0,
+            "cutoffEps": 0.0,
+        },
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 0.1,
+        },
+    },
+    "inputInfo": {
+        "aero_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+    },
+}
+
+
+def runPrimal(cutoffEps, shifts):
+    # run the primal for each mesh shift in the same solver, and return the CD for each shift
+    options = copy.deepcopy(daOptions)
+    options["fvSource"]["disk"]["cutoffEps"] = cutoffEps
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    volCoords0 = np.zeros(DASolver.solver.getNLocalPoints() * 3)
+    DASolver.solver.getOFMeshPoints(volCoords0)
+    CDs = []
+    for shift in shifts:
+        # move the whole mesh in the y direction, which moves the cells relative to the disk
+        volCoords = volCoords0.copy()
+        volCoords[1::3] += shift
+        DASolver.set_solver_input({"aero_vol_coords": volCoords})
+        DASolver()
+        funcs = {}
+        DASolver.evalFunctions(funcs)
+        CDs.append(funcs["CD"])
+    return np.array(CDs)
+
+
+CDAll = runPrimal(0.0, [0.0])[0]
+CDCutoff = runPrimal(5.0, [0.0])[0]
+print("CD cutoffEps = 0: ", CDAll, " cutoffEps = 5: ", CDCutoff)
+if abs(CDCutoff - CDAll) / abs(CDAll) > 1e-6:
+    print("DAFvSourceCutoff test failed!")
+    exit(1)
+
+# the primal on the shifted mesh should not depend on the previous mesh
+CDHistory = runPrimal(5.0, [0.0, 0.1])[1]
+CDScratch = runPrimal(5.0, [0.1])[0]
+print("CD shifted mesh with history: ", CDHistory, " from scratch: ", CDScratch)
+if abs(CDHistory - CDScratch) / abs(CDScratch) > 1e-6:
+    print("DAFvSourceCutoff mesh update test failed!")
+    exit(1)
+
+print("DAFvSourceCutoff test passed!")
@@ -0,0 +1,112 @@
+#!/usr/bin/env python
+"""
+Run Python tests for useJacConCache
+
+We compute dRdWTPC without the cache as the reference. With useJacConCache = True, the first run
+writes the cache and the second run reads it, and both dRdWTPC should match the reference. Then we
+change the connectivity level (maxResConLv4JacPCMat) and the mesh decomposition, and check that
+the cache is rejected and rewritten, and dRdWTPC matches the one computed without the cache
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import copy
+import time
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "useJacConCache": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+}
+
+cacheFile = "dRdWJacConCache_dRdWTPC_%d_proc0.bin" % gcomm.size
+
+
+def calcdRdWTPC(useJacConCache, maxResConLv4JacPCMat=None, decomposeMethod="scotch"):
+    # we need to re-decompose the mesh to change the decomposition method
+    if gcomm.rank == 0:
+        os.system("rm -rf processor*")
+    options = copy.deepcopy(daOptions)
+    options["useJacConCache"] = useJacConCache
+    options["decomposeParDict"] = {"method": decomposeMethod}
+    if maxResConLv4JacPCMat is not None:
+        options["maxResConLv4JacPCMat"] = maxResConLv4JacPCMat
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+    DASolver.solver.runColoring()
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    return dRdWTPC
+
+
+def getMTime():
+    mTime = None
+    if gcomm.rank == 0:
+        mTime = os.path.getmtime(cacheFile)
+    return gcomm.bcast(mTime, root=0)
+
+
+def checkMat(mat, matRef, testName):
+    normRef = matRef.norm()
+    mat.axpy(-1.0, matRef)
+    relDiff = mat.norm() / (normRef + 1e-16)
+    print("DAJacConCache %s dRdWTPC diff: " % testName, relDiff)
+    mat.destroy()
+    matRef.destroy()
+    if relDiff > 1e-12:
+        print("DAJacConCache %s test failed!" % testName)
+        exit(1)
+
+
+# the first run writes the cache and the second run reads it
+checkMat(calcdRdWTPC(True), calcdRdWTPC(False), "write")
+mTimeWrite = getMTime()
+time.sleep(1.1)
+checkMat(calcdRdWTPC(True), calcdRdWTPC(False), "read")
+if getMTime() != mTimeWrite:
+    print("DAJacConCache read test failed! The cache was rewritten")
+    exit(1)
+
+# change the connectivity level, the cache should be rejected and rewritten
+maxResConLv4JacPCMat = {"pRes": 1, "phiRes": 1, "URes": 1, "nuTildaRes": 1}
+time.sleep(1.1)
+checkMat(calcdRdWTPC(True, maxResConLv4JacPCMat), calcdRdWTPC(False, maxResConLv4JacPCMat), "option change")
+if getMTime() == mTimeWrite:
+    print("DAJacConCache option change test failed! The cache was not rewritten")
+    exit(1)
+
+# change the mesh decomposition, the cache should be rejected and rewritten
+mTimeWrite = getMTime()
+time.sleep(1.1)
+checkMat(calcdRdWTPC(True, decomposeMethod="simple"), calcdRdWTPC(False, decomposeMethod="simple"), "mesh change")
+if getMTime() == mTimeWrite:
+    print("DAJacConCache mesh change test failed! The cache was not rewritten")
+    exit(1)
+
+print("DAJacConCache test passed!")
@@ -0,0 +1,110 @@
+#!/usr/bin/env python
+"""
+Run Python tests for keepJacConInMemory
+
+We solve the adjoint equation twice with keepJacConInMemory = True. The second dRdWTPC reuses the
+connectivity, coloring, and preallocation kept in memory from the first one. Both adjoint solutions
+should match the one computed without keepJacConInMemory. The DAJacCon objects kept in memory are
+deleted after PetscFinalize when the script exits, which should not crash
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import copy
+import numpy as np
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "useAD": {"mode": "reverse"},
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "keepJacConInMemory": False,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "adjEqnOption": {"gmresRelTol": 1.0e-10, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+}
+
+
+def solveAdjoint(DASolver):
+    # the coloring should be found from the DAJacCon objects in memory for the second solve
+    DASolver.solver.runColoring()
+    DASolver.solverAD.initializedRdWTMatrixFree()
+
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    ksp = PETSc.KSP().create(PETSc.COMM_WORLD)
+    DASolver.solverAD.createMLRKSPMatrixFree(dRdWTPC, ksp)
+
+    nLocalAdjointStates = DASolver.getNLocalAdjointStates()
+    rhs = PETSc.Vec().create(PETSc.COMM_WORLD)
+    rhs.setSizes((nLocalAdjointStates, PETSc.DECIDE), bsize=1)
+    rhs.setFromOptions()
+    rhs.set(1.0)
+    psi = rhs.duplicate()
+    psi.zeroEntries()
+
+    fail = DASolver.solverAD.solveLinearEqn(ksp, rhs, psi)
+    psiArray = DASolver.vec2Array(psi)
+
+    ksp.destroy()
+    dRdWTPC.destroy()
+    DASolver.solverAD.destroydRdWTMatrixFree()
+
+    return fail, psiArray
+
+
+def createSolver(keepJacConInMemory):
+    options = copy.deepcopy(daOptions)
+    options["keepJacConInMemory"] = keepJacConInMemory
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+    return DASolver
+
+
+def relDiff(psi, psiRef):
+    diffNorm = gcomm.allreduce(np.linalg.norm(psi - psiRef) ** 2, op=MPI.SUM) ** 0.5
+    refNorm = gcomm.allreduce(np.linalg.norm(psiRef) ** 2, op=MPI.SUM) ** 0.5
+    return diffNorm / (refNorm + 1e-16)
+
+
+failRef, psiRef = solveAdjoint(createSolver(False))
+
+DASolver = createSolver(True)
+fail1, psi1 = solveAdjoint(DASolver)
+fail2, psi2 = solveAdjoint(DASolver)
+
+diff1 = relDiff(psi1, psiRef)
+diff2 = relDiff(psi2, psiRef)
+print("DAJacConInMemory psi diff first solve: ", diff1, " second solve: ", diff2)
+if failRef or fail1 or fail2:
+    print("DAJacConInMemory test failed! The adjoint does not converge.")
+    exit(1)
+elif diff1 > 1e-8 or diff2 > 1e-8:
+    print("DAJacConInMemory test failed!")
+    exit(1)
+else:
+    print("DAJacConInMemory test passed!")
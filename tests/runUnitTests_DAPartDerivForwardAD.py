@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+"""
+Run Python tests for adjPartDerivMethod = forwardAD
+
+We compute dRdWTPC with the coloring accelerated finite-difference and forward-mode AD. The
+forward-mode AD gives the exact partial derivatives, so the two dRdWTPC should match to within
+the FD truncation error
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import copy
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "useAD": {"mode": "reverse"},
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "adjPartDerivMethod": "FD",
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+}
+
+
+def calcdRdWTPC(partDerivMethod):
+    options = copy.deepcopy(daOptions)
+    options["adjPartDerivMethod"] = partDerivMethod
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+    DASolver.solver.runColoring()
+    dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+    DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+    return dRdWTPC
+
+
+dRdWTPCFD = calcdRdWTPC("FD")
+dRdWTPCAD = calcdRdWTPC("forwardAD")
+
+normAD = dRdWTPCAD.norm()
+dRdWTPCFD.axpy(-1.0, dRdWTPCAD)
+relDiff = dRdWTPCFD.norm() / (normAD + 1e-16)
+print("DAPartDerivForwardAD dRdWTPC FD vs forwardAD diff: ", relDiff)
+
+dRdWTPCFD.destroy()
+dRdWTPCAD.destroy()
+
+if relDiff > 1e-4:
+    print("DAPartDerivForwardAD test failed!")
+    exit(1)
+else:
+    print("DAPartDerivForwardAD test passed!")
@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the batched neural network evaluation in DARegression
+
+We compute the residuals and the reverse-mode AD derivatives of the residuals wrt the neural
+network parameters and the states with nnBlockSize = 0 (one cell at a time) and nnBlockSize > 0
+(batched evaluation with the analytical reverse pass) for all the activation functions. They should
+match. The derivatives wrt the states also check the reverse pass through the network inputs
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import numpy as np
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1e-12,
+    "primalMinResTolDiff": 1e12,
+    "printDAOptions": False,
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "regressionModel": {
+        "active": True,
+        "reg_model": {
+            "modelType": "neuralNetwork",
+            "inputNames": ["VoS", "PoD", "chiSA", "pGradStream", "PSoSS", "SCurv", "UOrth"],
+            "outputName": "betaFINuTilda",
+            "hiddenLayerNeurons": [5, 5],
+            "inputShift": [0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0],
+            "inputScale": [1.0, 1.0, 1.0, 1.0, 1.0, 1.0, 1.0],
+            "outputShift": 1.0,
+            "outputScale": 1.0,
+            "activationFunction": "tanh",
+            "printInputInfo": False,
+            "outputUpperBound": 1e2,
+            "outputLowerBound": -1e2,
+            "defaultOutputValue": 1.0,
+        },
+    },
+    "inputInfo": {
+        "reg_model": {"type": "regressionPar", "components": ["solver"]},
+    },
+}
+
+
+def calcResidualsAndDerivs(activation, blockSize):
+    daOptions["regressionModel"]["reg_model"]["activationFunction"] = activation
+    daOptions["regressionModel"]["reg_model"]["nnBlockSize"] = blockSize
+
+    DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+
+    nParameters = DASolver.getNRegressionParameters("reg_model")
+    parameters = 0.1 * np.sin(np.arange(nParameters, dtype=float))
+    DASolver.solver.setSolverInput("reg_model", "regressionPar", nParameters, parameters, np.zeros(nParameters))
+    DASolver.solverAD.setSolverInput("reg_model", "regressionPar", nParameters, parameters, np.zeros(nParameters))
+
+    localAdjSize = DASolver.getNLocalAdjointStates()
+    residuals = np.zeros(localAdjSize)
+    DASolver.solver.calcOutput("aero_residuals", "residual", residuals)
+
+    seed = 1.0 + np.cos(np.arange(localAdjSize, dtype=float))
+    product = np.zeros(nParameters)
+    DASolver.solverAD.calcJacTVecProduct(
+        "reg_model",
+        "regressionPar",
+        parameters,
+        "aero_residuals",
+        "residual",
+        seed,
+        product,
+    )
+
+    states = DASolver.getStates()
+    productW = np.zeros(localAdjSize)
+    DASolver.solverAD.calcJacTVecProduct(
+        "aero_states",
+        "stateVar",
+        states,
+        "aero_residuals",
+        "residual",
+        seed,
+        productW,
+    )
+
+    return residuals, product, productW
+
+
+def relDiff(vals, refs):
+    diff = gcomm.allreduce(np.linalg.norm(vals - refs) ** 2, op=MPI.SUM) ** 0.5
+    ref = gcomm.allreduce(np.linalg.norm(refs) ** 2, op=MPI.SUM) ** 0.5
+    return diff / (ref + 1e-16)
+
+
+for activation in ["sigmoid", "tanh", "relu"]:
+    resRef, derivRef, derivWRef = calcResidualsAndDerivs(activation, 0)
+    for blockSize in [1, 64]:
+        res, deriv, derivW = calcResidualsAndDerivs(activation, blockSize)
+        resDiff = relDiff(res, resRef)
+        derivDiff = relDiff(deriv, derivRef)
+        derivWDiff = relDiff(derivW, derivWRef)
+        print(
+            "%s nnBlockSize %d: residual diff %g, deriv diff %g, state deriv diff %g"
+            % (activation, blockSize, resDiff, derivDiff, derivWDiff)
+        )
+        if resDiff > 1e-12 or derivDiff > 1e-10 or derivWDiff > 1e-10:
+            print("DARegression %s nnBlockSize %d test failed!" % (activation, blockSize))
+            exit(1)
+
+print("DARegression nnBlockSize test passed!")
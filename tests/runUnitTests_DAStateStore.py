@@ -0,0 +1,98 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the in-memory state store of the unsteady adjoint (checkpointMode = memory)
+
+We run the same unsteady primal with stateCompression = None, lossless, and quantize, and get the
+stored states for all time indices. The uncompressed states at the end time should be bitwise equal
+to the solver's states, the lossless states should be bitwise equal to the uncompressed ones, and the
+error of the quantized states should be bounded by stateCompressionTol times the max state magnitude
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin checkpoints")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible.unsteady/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+stateCompressionTol = 1e-6
+
+daOptions = {
+    "solverName": "DAPimpleFoam",
+    "printDAOptions": False,
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "unsteadyAdjoint": {
+        "mode": "timeAccurate",
+        "readZeroFields": True,
+        "checkpointMode": "memory",
+        "stateCompression": "None",
+        "stateCompressionTol": stateCompressionTol,
+        # use a small key interval so that most snapshots are delta encoded
+        "stateKeyInterval": 3,
+    },
+}
+
+
+def runPrimal(stateCompression):
+    if gcomm.rank == 0:
+        os.system("rm -rf processor*")
+
+    options = copy.deepcopy(daOptions)
+    options["unsteadyAdjoint"]["stateCompression"] = stateCompression
+    DASolver = PYDAFOAM(options=options, comm=gcomm)
+    DASolver()
+
+    endTimeIndex = round(DASolver.solver.getEndTime() / DASolver.solver.getDeltaT())
+    # the old time level of the initial time is saved as the time index -1
+    storedStates = {}
+    for timeIndex in range(-1, endTimeIndex + 1):
+        if not DASolver.solver.hasStoredStates(timeIndex):
+            print("DAStateStore test failed! The states for time index %d are not stored" % timeIndex)
+            exit(1)
+        states = np.zeros(DASolver.getNLocalAdjointStates())
+        DASolver.solver.getStoredStates(timeIndex, states)
+        storedStates[timeIndex] = states
+
+    return storedStates, DASolver.getStates(), endTimeIndex
+
+
+statesRaw, statesEnd, endTimeIndex = runPrimal("None")
+
+# the uncompressed states should be exactly the solver's states
+isEqual = gcomm.allreduce(int(np.array_equal(statesRaw[endTimeIndex], statesEnd)), op=MPI.MIN)
+if not isEqual:
+    print("DAStateStore raw test failed!")
+    exit(1)
+
+# the primal is deterministic, so the lossless states should be bitwise equal to the uncompressed ones
+statesLossless = runPrimal("lossless")[0]
+for timeIndex in statesRaw.keys():
+    isEqual = gcomm.allreduce(int(np.array_equal(statesLossless[timeIndex], statesRaw[timeIndex])), op=MPI.MIN)
+    if not isEqual:
+        print("DAStateStore lossless test failed at time index %d!" % timeIndex)
+        exit(1)
+
+# the quantization error is bounded by stateCompressionTol times the max magnitude of each state
+# variable in the key snapshots, which is no larger than the max magnitude of all states
+statesQuantize = runPrimal("quantize")[0]
+maxMag = max([np.max(np.abs(states)) for states in statesRaw.values()])
+maxMag = gcomm.allreduce(maxMag, op=MPI.MAX)
+for timeIndex in statesRaw.keys():
+    maxErr = gcomm.allreduce(np.max(np.abs(statesQuantize[timeIndex] - statesRaw[timeIndex])), op=MPI.MAX)
+    if maxErr > stateCompressionTol * maxMag * (1.0 + 1e-6):
+        print("DAStateStore quantize test failed at time index %d! Error %g max %g" % (timeIndex, maxErr, maxMag))
+        exit(1)
+
+print("DAStateStore test passed!")
@@ -73,6 +73,20 @@ def runTurbTests(daOptions, gcomm, turbName, refs):
     else:
         print("%s test passed!" % turbName)
 
+    # the residuals and AD derivatives with the preaccumulated source kernels (SA Stilda and fw,
+    # SST F1 and F23) should be the same as the ones with the field functions. We perturb the
+    # converged states such that the residuals are not close to zero
+    statesPerturbed = states * (1.0 + 0.01 * np.sin(np.arange(len(states))))
+    DASolver.solverAD.updateOFFields(statesPerturbed)
+    checkVals = np.zeros(4)
+    DASolver.solverAD.calcSourcePreaccumulationCheck(checkVals)
+    print("%s preaccumulation check: " % turbName, checkVals)
+    if checkVals[0] / (checkVals[1] + 1e-16) > 1e-10 or checkVals[2] / (checkVals[3] + 1e-16) > 1e-10:
+        print("%s preaccumulation test failed!" % turbName)
+        exit(1)
+    else:
+        print("%s preaccumulation test passed!" % turbName)
+
 
 # *********************
 # compressible models
@@ -0,0 +1,63 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the boundary-only wall stress in DATurbulenceModel
+
+We compare devRhoReffBoundary, which computes the Gauss linear gradients for the patch face
+cells only, with devRhoReff().boundaryField() on a decomposed mesh. The wall face cells that
+also touch processor boundaries need the interpolated processor face values, so both the values
+and the reverse-mode AD derivatives should match to machine precision
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import numpy as np
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    # the boundary-only wall stress is used for the Gauss linear grad(U) scheme only
+    os.system("foamDictionary system/fvSchemes -entry 'gradSchemes/grad(U)' -set 'Gauss linear'")
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1e-12,
+    "primalMinResTolDiff": 1e12,
+    "printDAOptions": False,
+    "primalBC": {
+        "useWallFunction": False,
+    },
+}
+
+DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+DASolver()
+
+checkVals = np.zeros(4)
+DASolver.solver.calcDevRhoReffBoundaryCheck(checkVals)
+print("devRhoReffBoundary values NoAD: ", checkVals)
+if checkVals[0] / (checkVals[1] + 1e-16) > 1e-10:
+    print("devRhoReffBoundary NoAD test failed!")
+    exit(1)
+else:
+    print("devRhoReffBoundary NoAD test passed!")
+
+# assign the converged states to the AD solver and compare the values and AD derivatives
+states = DASolver.getStates()
+DASolver.solverAD.updateOFFields(states)
+checkVals = np.zeros(4)
+DASolver.solverAD.calcDevRhoReffBoundaryCheck(checkVals)
+print("devRhoReffBoundary values and derivs AD: ", checkVals)
+if checkVals[0] / (checkVals[1] + 1e-16) > 1e-10:
+    print("devRhoReffBoundary AD value test failed!")
+    exit(1)
+elif checkVals[3] < 1e-16 or checkVals[2] / checkVals[3] > 1e-10:
+    print("devRhoReffBoundary AD derivative test failed!")
+    exit(1)
+else:
+    print("devRhoReffBoundary AD test passed!")
@@ -0,0 +1,119 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the inexact adjoint (inexactAdjoint-active)
+
+We compute the total derivatives with a tight adjoint tolerance as the reference, then with the
+inexact adjoint whose target relative gradient error is fixed to gradRelTol (gradRelTolMin =
+gradRelTolMax). The relative error of the inexact total derivatives should be within
+gradRelTol * safetyFactor
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from mphys.multipoint import Multipoint
+from dafoam.mphys import DAFoamBuilder
+from mphys.scenario_aerodynamic import ScenarioAerodynamic
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ChannelConjugateHeatV4/thermal")
+if gcomm.rank == 0:
+    os.system("rm -rf processor*")
+
+gradRelTol = 1.0e-3
+safetyFactor = 10.0
+
+daOptions = {
+    "designSurfaces": ["channel_outer", "channel_inner", "channel_sides"],
+    "solverName": "DAHeatTransferFoam",
+    "primalMinResTol": 1e-12,
+    "printDAOptions": False,
+    "function": {
+        "HFX": {
+            "type": "wallHeatFlux",
+            "source": "patchToFace",
+            "patches": ["channel_inner"],
+            "scale": 1,
+        },
+    },
+    "fvSource": {
+        "source2": {
+            "type": "heatSource",
+            "source": "cylinderSmooth",
+            "center": [0.201, 0.056, 0.026],
+            "axis": [1.0, 0.0, 0.0],
+            "length": 0.4,
+            "radius": 0.05,
+            "power": 1000.0,
+            "eps": 0.01,
+            "snapCenter2Cell": True,
+        },
+    },
+    "adjEqnOption": {"gmresRelTol": 1.0e-12, "gmresAbsTol": 1.0e-16, "pcFillLevel": 1, "jacMatReOrdering": "rcm"},
+    "inexactAdjoint": {
+        "active": False,
+        "gradRelTolMin": gradRelTol,
+        "gradRelTolMax": gradRelTol,
+        "safetyFactor": safetyFactor,
+    },
+    "inputInfo": {
+        "heat_source": {
+            "type": "fvSourcePar",
+            "fvSourceName": "source2",
+            "indices": [0, 6],
+            "components": ["solver", "function"],
+        },
+    },
+}
+
+
+class Top(Multipoint):
+    def initialize(self):
+        self.options.declare("daOptions")
+
+    def setup(self):
+        dafoam_builder = DAFoamBuilder(self.options["daOptions"], None, scenario="aerodynamic")
+        dafoam_builder.initialize(self.comm)
+
+        # ivc to keep the top level DVs
+        self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+        self.mphys_add_scenario("cruise", ScenarioAerodynamic(aero_builder=dafoam_builder))
+
+    def configure(self):
+        self.dvs.add_output("heat_source", val=np.array([0.3, 0.45]))
+        self.connect("heat_source", "cruise.heat_source")
+        self.add_design_var("heat_source", lower=-50.0, upper=50.0, scaler=1.0)
+        self.add_objective("cruise.aero_post.HFX", scaler=1.0)
+
+
+def calcTotals(inexactAdjoint):
+    if gcomm.rank == 0:
+        os.system("rm -rf processor*")
+
+    options = copy.deepcopy(daOptions)
+    options["inexactAdjoint"]["active"] = inexactAdjoint
+
+    prob = om.Problem()
+    prob.model = Top(daOptions=options)
+    prob.setup(mode="rev")
+    prob.run_model()
+    totals = prob.compute_totals(of=["cruise.aero_post.HFX"], wrt=["heat_source"])
+    return np.array(totals[("cruise.aero_post.HFX", "heat_source")]).flatten()
+
+
+derivsRef = calcTotals(False)
+derivs = calcTotals(True)
+
+relErr = np.linalg.norm(derivs - derivsRef) / (np.linalg.norm(derivsRef) + 1e-16)
+print("InexactAdjoint derivs: ", derivs, " ref: ", derivsRef, " rel error: ", relErr)
+if relErr > gradRelTol * safetyFactor:
+    print("InexactAdjoint test failed!")
+    exit(1)
+else:
+    print("InexactAdjoint test passed!")
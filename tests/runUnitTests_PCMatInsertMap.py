@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+"""
+Run Python tests for usePCMatInsertMap
+
+We compute dRdWTPC twice on a decomposed mesh. The first computation sets the template sparsity
+pattern and the second one writes the values directly into the CSR arrays using the precomputed
+slots. The transposed entries whose rows are on the other processors need MatSetValue, so we check
+that the slots are still used for all colors and that both dRdWTPC are the same
+"""
+
+from mpi4py import MPI
+from dafoam import PYDAFOAM
+import os
+import sys
+import numpy as np
+import petsc4py
+from petsc4py import PETSc
+
+petsc4py.init(sys.argv)
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+
+U0 = 10.0
+
+daOptions = {
+    "solverName": "DASimpleFoam",
+    "primalMinResTol": 1.0e-12,
+    "primalMinResTolDiff": 1e4,
+    "printDAOptions": False,
+    "usePCMatInsertMap": True,
+    "primalBC": {
+        "U0": {"variable": "U", "patches": ["inlet"], "value": [U0, 0.0, 0.0]},
+        "p0": {"variable": "p", "patches": ["outlet"], "value": [0.0]},
+        "useWallFunction": False,
+        "transport:nu": 1.5e-5,
+    },
+}
+
+DASolver = PYDAFOAM(options=daOptions, comm=gcomm)
+DASolver()
+DASolver.solver.runColoring()
+
+dRdWTPCRef = PETSc.Mat().create(PETSc.COMM_WORLD)
+DASolver.solverPC.calcdRdWT(1, dRdWTPCRef)
+
+dRdWTPC = PETSc.Mat().create(PETSc.COMM_WORLD)
+DASolver.solverPC.calcdRdWT(1, dRdWTPC)
+
+stats = np.zeros(2)
+DASolver.solverPC.getPCMatSlotColorStats(stats)
+print("PCMatInsertMap colors set with the slots: %d of %d" % (stats[0], stats[1]))
+if stats[1] == 0 or stats[0] != stats[1]:
+    print("PCMatInsertMap slot test failed!")
+    exit(1)
+
+normRef = dRdWTPCRef.norm()
+dRdWTPC.axpy(-1.0, dRdWTPCRef)
+relDiff = dRdWTPC.norm() / (normRef + 1e-16)
+print("PCMatInsertMap dRdWTPC diff: ", relDiff)
+if relDiff > 1e-12:
+    print("PCMatInsertMap value test failed!")
+    exit(1)
+
+dRdWTPCRef.destroy()
+dRdWTPC.destroy()
+
+print("PCMatInsertMap test passed!")
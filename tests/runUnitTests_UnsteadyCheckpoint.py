@@ -0,0 +1,196 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the binomial checkpointing of the unsteady adjoint
+
+We compute the unsteady adjoint derivatives without checkpointing (the states are written to
+and read from the disk for every time step), and with the binomial checkpointing where the
+snapshots are placed during the primal run and kept in memory or on the disk. We also run the
+binomial checkpointing with useSingleSolverInstance, where the ADR solver runs the primal. All of
+them should give the same function values and derivatives
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from openmdao.api import Group
+from dafoam.mphys.mphys_dafoam import DAFoamBuilderUnsteady
+from pygeo.mphys import OM_DVGEOCOMP
+from pygeo import geo_utils
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin checkpoints")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible.unsteady/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+# aero setup
+U0 = 10.0
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DAPimpleFoam",
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "unsteadyAdjoint": {
+        "mode": "timeAccurate",
+        "PCMatPrecomputeInterval": 5,
+        "PCMatUpdateInterval": 1,
+        "readZeroFields": True,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+            "timeOp": "average",
+        },
+    },
+    "adjStateOrdering": "cell",
+    "adjEqnOption": {"gmresRelTol": 1.0e-12, "pcFillLevel": 1, "jacMatReOrdering": "natural"},
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "aero_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    "unsteadyCompOutput": {
+        "CD": ["CD"],
+    },
+}
+
+meshOptions = {
+    "gridFile": os.getcwd(),
+    "fileType": "OpenFOAM",
+    # point and normal for the symmetry plane
+    "symmetryPlanes": [],
+}
+
+
+class Top(Group):
+    def initialize(self):
+        self.options.declare("daOptions")
+
+    def setup(self):
+
+        self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+        # add the geometry component, we dont need a builder because we do it here.
+        self.add_subsystem("geometry", OM_DVGEOCOMP(file="FFD/FFD.xyz", type="ffd"), promotes=["*"])
+
+        self.add_subsystem(
+            "cruise",
+            DAFoamBuilderUnsteady(solver_options=self.options["daOptions"], mesh_options=meshOptions),
+            promotes=["*"],
+        )
+
+        self.connect("x_aero0", "x_aero")
+
+    def configure(self):
+
+        # create geometric DV setup
+        points = self.cruise.get_surface_mesh()
+
+        # add pointset
+        self.geometry.nom_add_discipline_coords("aero", points)
+
+        # add the dv_geo object to the builder solver. This will be used to write deformed FFDs
+        self.cruise.solver.add_dvgeo(self.geometry.DVGeo)
+
+        # geometry setup
+        pts = self.geometry.DVGeo.getLocalIndex(0)
+        indexList = pts[1, 0, 1].flatten()
+        PS = geo_utils.PointSelect("list", indexList)
+        self.geometry.nom_addLocalDV(dvName="shape", pointSelect=PS)
+
+        # add the design variables to the dvs component's output
+        self.dvs.add_output("patchV", val=np.array([10.0, 0.0]))
+        self.dvs.add_output("shape", val=np.zeros(1))
+        self.dvs.add_output("x_aero_in", val=points, distributed=True)
+
+        # define the design variables to the top level
+        self.add_design_var("patchV", indices=[0], lower=-50.0, upper=50.0, scaler=1.0)
+        self.add_design_var("shape", lower=-10.0, upper=10.0, scaler=1.0)
+
+        # add constraints and the objective
+        self.add_objective("CD", scaler=1.0)
+
+
+def runAdjoint(
+    checkpointMode, nCheckpoints=2, checkpointOnDisk=False, useSingleSolverInstance=False, PCMatPrecomputeInterval=5
+):
+    options = copy.deepcopy(daOptions)
+    options["useSingleSolverInstance"] = useSingleSolverInstance
+    options["unsteadyAdjoint"]["PCMatPrecomputeInterval"] = PCMatPrecomputeInterval
+    options["unsteadyAdjoint"]["checkpointMode"] = checkpointMode
+    options["unsteadyAdjoint"]["nCheckpoints"] = nCheckpoints
+    options["unsteadyAdjoint"]["checkpointOnDisk"] = checkpointOnDisk
+
+    prob = om.Problem()
+    prob.model = Top(daOptions=options)
+    prob.setup(mode="rev")
+    prob.run_model()
+    totals = prob.compute_totals(of=["CD"], wrt=["patchV", "shape"])
+
+    CD = prob.get_val("CD")[0]
+    derivs = np.array([totals[("CD", "patchV")][0][0], totals[("CD", "shape")][0][0]])
+    nRecomputeSteps[0] = prob.model.cruise.DASolver.nRecomputeSteps
+    return CD, derivs
+
+
+# the number of recomputed time steps in the last runAdjoint call
+nRecomputeSteps = [0]
+
+
+CDRef, derivsRef = runAdjoint("None")
+print("checkpointMode None: ", CDRef, derivsRef)
+
+for nCheckpoints, checkpointOnDisk in [[2, False], [2, True], [100, False]]:
+    CD, derivs = runAdjoint("binomial", nCheckpoints, checkpointOnDisk)
+    print("checkpointMode binomial (%d, %s): " % (nCheckpoints, checkpointOnDisk), CD, derivs)
+    if abs(CD - CDRef) / abs(CDRef) > 1e-10:
+        print("UnsteadyCheckpoint function test failed!")
+        exit(1)
+    if np.max(np.abs(derivs - derivsRef) / np.maximum(np.abs(derivsRef), 1e-16)) > 1e-6:
+        print("UnsteadyCheckpoint derivative test failed!")
+        exit(1)
+
+# the extra PC mats should not increase the recomputation. Here the PC mats are computed for
+# every 5 steps and for the end time only, and the number of recomputed steps should be the same
+nRecomputeSteps5 = None
+for PCMatPrecomputeInterval in [5, 100000]:
+    runAdjoint("binomial", 2, False, PCMatPrecomputeInterval=PCMatPrecomputeInterval)
+    print("PCMatPrecomputeInterval %d: recomputed steps %d" % (PCMatPrecomputeInterval, nRecomputeSteps[0]))
+    if nRecomputeSteps5 is None:
+        nRecomputeSteps5 = nRecomputeSteps[0]
+    elif nRecomputeSteps[0] != nRecomputeSteps5:
+        print("UnsteadyCheckpoint recompute step test failed!")
+        exit(1)
+
+# the ADR solver runs the unsteady primal if useSingleSolverInstance = True
+CD, derivs = runAdjoint("binomial", 2, False, useSingleSolverInstance=True)
+print("checkpointMode binomial (2, False) useSingleSolverInstance: ", CD, derivs)
+if abs(CD - CDRef) / abs(CDRef) > 1e-10:
+    print("UnsteadyCheckpoint useSingleSolverInstance function test failed!")
+    exit(1)
+if np.max(np.abs(derivs - derivsRef) / np.maximum(np.abs(derivsRef), 1e-16)) > 1e-6:
+    print("UnsteadyCheckpoint useSingleSolverInstance derivative test failed!")
+    exit(1)
+
+print("UnsteadyCheckpoint test passed!")
@@ -0,0 +1,162 @@
+#!/usr/bin/env python
+"""
+Run Python tests for the tape session of the unsteady adjoint (unsteadyAdjoint-tapeSession)
+
+We compute the unsteady adjoint derivatives with tapeSession = False, where dFdW, dFdX, dRdXTPsi,
+dRdWOldTPsi, and the matrix-free adjoint solution record their own tapes, and with tapeSession =
+True, where the tape is recorded only once for each time step and reused. Both should give the
+same function values and derivatives
+"""
+
+from mpi4py import MPI
+import os
+import copy
+import numpy as np
+from testFuncs import *
+
+import openmdao.api as om
+from openmdao.api import Group
+from dafoam.mphys.mphys_dafoam import DAFoamBuilderUnsteady
+from pygeo.mphys import OM_DVGEOCOMP
+from pygeo import geo_utils
+
+gcomm = MPI.COMM_WORLD
+
+os.chdir("./reg_test_files-main/ConvergentChannel")
+if gcomm.rank == 0:
+    os.system("rm -rf 0/* processor* *.bin")
+    os.system("cp -r 0.incompressible/* 0/")
+    os.system("cp -r system.incompressible.unsteady/* system/")
+    os.system("cp -r constant/turbulenceProperties.sa constant/turbulenceProperties")
+    replace_text_in_file("system/fvSchemes", "meshWave;", "meshWaveFrozen;")
+
+# aero setup
+U0 = 10.0
+
+daOptions = {
+    "designSurfaces": ["walls"],
+    "solverName": "DAPimpleFoam",
+    "primalBC": {
+        "useWallFunction": False,
+    },
+    "unsteadyAdjoint": {
+        "mode": "timeAccurate",
+        "PCMatPrecomputeInterval": 5,
+        "PCMatUpdateInterval": 1,
+        "readZeroFields": True,
+    },
+    "function": {
+        "CD": {
+            "type": "force",
+            "source": "patchToFace",
+            "patches": ["walls"],
+            "directionMode": "fixedDirection",
+            "direction": [1.0, 0.0, 0.0],
+            "scale": 1.0,
+            "timeOp": "average",
+        },
+    },
+    "adjStateOrdering": "cell",
+    "adjEqnOption": {"gmresRelTol": 1.0e-12, "pcFillLevel": 1, "jacMatReOrdering": "natural"},
+    "normalizeStates": {"U": U0, "p": U0 * U0 / 2.0, "phi": 1.0, "nuTilda": 1e-3},
+    "inputInfo": {
+        "aero_vol_coords": {"type": "volCoord", "components": ["solver", "function"]},
+        "patchV": {
+            "type": "patchVelocity",
+            "patches": ["inlet"],
+            "flowAxis": "x",
+            "normalAxis": "y",
+            "components": ["solver", "function"],
+        },
+    },
+    "unsteadyCompOutput": {
+        "CD": ["CD"],
+    },
+}
+
+meshOptions = {
+    "gridFile": os.getcwd(),
+    "fileType": "OpenFOAM",
+    # point and normal for the symmetry plane
+    "symmetryPlanes": [],
+}
+
+
+class Top(Group):
+    def initialize(self):
+        self.options.declare("daOptions")
+
+    def setup(self):
+
+        self.add_subsystem("dvs", om.IndepVarComp(), promotes=["*"])
+
+        # add the geometry component, we dont need a builder because we do it here.
+        self.add_subsystem("geometry", OM_DVGEOCOMP(file="FFD/FFD.xyz", type="ffd"), promotes=["*"])
+
+        self.add_subsystem(
+            "cruise",
+            DAFoamBuilderUnsteady(solver_options=self.options["daOptions"], mesh_options=meshOptions),
+            promotes=["*"],
+        )
+
+        self.connect("x_aero0", "x_aero")
+
+    def configure(self):
+
+        # create geometric DV setup
+        points = self.cruise.get_surface_mesh()
+
+        # add pointset
+        self.geometry.nom_add_discipline_coords("aero", points)
+
+        # add the dv_geo object to the builder solver. This will be used to write deformed FFDs
+        self.cruise.solver.add_dvgeo(self.geometry.DVGeo)
+
+        # geometry setup
+        pts = self.geometry.DVGeo.getLocalIndex(0)
+        indexList = pts[1, 0, 1].flatten()
+        PS = geo_utils.PointSelect("list", indexList)
+        self.geometry.nom_addLocalDV(dvName="shape", pointSelect=PS)
+
+        # add the design variables to the dvs component's output
+        self.dvs.add_output("patchV", val=np.array([10.0, 0.0]))
+        self.dvs.add_output("shape", val=np.zeros(1))
+        self.dvs.add_output("x_aero_in", val=points, distributed=True)
+
+        # define the design variables to the top level
+        self.add_design_var("patchV", indices=[0], lower=-50.0, upper=50.0, scaler=1.0)
+        self.add_design_var("shape", lower=-10.0, upper=10.0, scaler=1.0)
+
+        # add constraints and the objective
+        self.add_objective("CD", scaler=1.0)
+
+
+def runAdjoint(tapeSession):
+    options = copy.deepcopy(daOptions)
+    options["unsteadyAdjoint"]["tapeSession"] = tapeSession
+
+    prob = om.Problem()
+    prob.model = Top(daOptions=options)
+    prob.setup(mode="rev")
+    prob.run_model()
+    totals = prob.compute_totals(of=["CD"], wrt=["patchV", "shape"])
+
+    CD = prob.get_val("CD")[0]
+    derivs = np.array([totals[("CD", "patchV")][0][0], totals[("CD", "shape")][0][0]])
+    return CD, derivs
+
+
+CDRef, derivsRef = runAdjoint(False)
+print("tapeSession False: ", CDRef, derivsRef)
+
+CD, derivs = runAdjoint(True)
+print("tapeSession True: ", CD, derivs)
+
+if abs(CD - CDRef) / abs(CDRef) > 1e-10:
+    print("UnsteadyTapeSession function test failed!")
+    exit(1)
+elif np.max(np.abs(derivs - derivsRef) / np.maximum(np.abs(derivsRef), 1e-16)) > 1e-8:
+    print("UnsteadyTapeSession derivative test failed!")
+    exit(1)
+else:
+    print("UnsteadyTapeSession test passed!")